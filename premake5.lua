@@ -44,3 +44,25 @@ workspace "d3d9-wrapper"
 	  libdirs { "source/dxsdk/lib/x64" }
 
 project "d3d9-wrapper"
+
+-- Unit tests of the header-only parts that run without Direct3D, built as a console program next to the wrapper
+project "tests"
+   kind "ConsoleApp"
+   targetname "%{prj.name}"
+   targetextension ".exe"
+   targetdir "build/bin/%{cfg.platform}/%{cfg.buildcfg}"
+   objdir "build/obj/%{prj.name}"
+   removefiles { "source/*.h", "source/*.cpp", "source/*.def", "source/*.rc" }
+   files { "tests/Test.h", "tests/TestMain.cpp", "tests/*Tests.cpp" }
+   includedirs { "source" }
+
+-- Call overhead of the two interception modes on a stand-in COM object, run by hand on a Release build
+project "benchmark"
+   kind "ConsoleApp"
+   targetname "%{prj.name}"
+   targetextension ".exe"
+   targetdir "build/bin/%{cfg.platform}/%{cfg.buildcfg}"
+   objdir "build/obj/%{prj.name}"
+   removefiles { "source/*.h", "source/*.cpp", "source/*.def", "source/*.rc" }
+   files { "tests/InterceptionBenchmark.cpp" }
+   includedirs { "source" }
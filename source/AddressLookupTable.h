@@ -1,70 +1,288 @@
 #pragma once
 
-#include <unordered_map>
 #include <algorithm>
+#include <utility>
+#include "AddressMap.h"
+#include "WrapperPool.h"
 
-constexpr UINT MaxIndex = 16;
+template <typename... Ts>
+struct TypeList { };
+
+// One cache per wrapper type, in this order. A type missing from the list fails to compile instead
+// of silently sharing a cache with unrelated wrappers.
+using AddressCacheTypes = TypeList<
+	m_IDirect3D9Ex,
+	m_IDirect3DDevice9Ex,
+	m_IDirect3DCubeTexture9,
+	m_IDirect3DIndexBuffer9,
+	m_IDirect3DPixelShader9,
+	m_IDirect3DQuery9,
+	m_IDirect3DStateBlock9,
+	m_IDirect3DSurface9,
+	m_IDirect3DSwapChain9Ex,
+	m_IDirect3DTexture9,
+	m_IDirect3DVertexBuffer9,
+	m_IDirect3DVertexDeclaration9,
+	m_IDirect3DVertexShader9,
+	m_IDirect3DVolume9,
+	m_IDirect3DVolumeTexture9>;
+
+template <typename T>
+constexpr bool TypeNotListed = false;
+
+template <typename T, typename List>
+struct IndexOfType
+{
+	static_assert(TypeNotListed<T>, "Wrapper type is missing from AddressCacheTypes");
+};
+
+template <typename T, typename... Ts>
+struct IndexOfType<T, TypeList<T, Ts...>>
+{
+	static constexpr UINT Index = 0;
+};
+
+template <typename T, typename U, typename... Ts>
+struct IndexOfType<T, TypeList<U, Ts...>>
+{
+	static constexpr UINT Index = 1 + IndexOfType<T, TypeList<Ts...>>::Index;
+};
+
+template <typename List>
+struct TypeCount;
+
+template <typename... Ts>
+struct TypeCount<TypeList<Ts...>>
+{
+	static constexpr UINT Count = sizeof...(Ts);
+};
+
+constexpr UINT MaxIndex = TypeCount<AddressCacheTypes>::Count;
+
+// Mip levels cached per texture wrapper; D3D9 textures are at most 16384 texels wide, which is 15 levels
+constexpr UINT MaxCachedLevels = 16;
+
+template <typename D>
+class AddressLookupTable;
+
+class AddressLookupTableObject
+{
+	template <typename D>
+	friend class AddressLookupTable;
+
+public:
+	explicit AddressLookupTableObject(D3DRESOURCETYPE Type = (D3DRESOURCETYPE)0) : ResourceType(Type) { }
+	virtual ~AddressLookupTableObject() { }
+
+	// Proxy address this wrapper is registered under, so it can be removed without scanning the cache
+	void *GetProxyAddress() const { return ProxyAddress; }
+	void SetProxyAddress(void *Proxy) { ProxyAddress = Proxy; }
+
+	// Fixed at construction; zero for wrappers that are not resources
+	D3DRESOURCETYPE GetResourceType() const { return ResourceType; }
+
+	// Every resource wrapper derives from its D3D interface first and from this class second. The
+	// interfaces hold nothing but a vtable pointer, so the object always sits right behind it and
+	// can be reached from any wrapped resource without knowing its concrete type.
+	static AddressLookupTableObject *FromInterface(IUnknown *pInterface)
+	{
+		return reinterpret_cast<AddressLookupTableObject *>(reinterpret_cast<BYTE *>(pInterface) + sizeof(IUnknown));
+	}
+
+protected:
+	// Lets a container drop a child from its per-level cache when the child is destroyed on its own
+	virtual void ForgetChild(AddressLookupTableObject *) { }
+
+private:
+	// Texture levels have no reference count of their own in the runtime, Release on a level releases
+	// the texture. Back buffers keep their own count and can outlive the wrapper of their swap chain.
+	bool OwnsChildren() const
+	{
+		return ResourceType == D3DRTYPE_TEXTURE || ResourceType == D3DRTYPE_CUBETEXTURE || ResourceType == D3DRTYPE_VOLUMETEXTURE;
+	}
+
+	void *ProxyAddress = nullptr;
+	const D3DRESOURCETYPE ResourceType;
+	UINT CacheIndex = 0;
+
+	// Children are linked to the wrapper they were taken from so it can cache them per level. The
+	// children of a texture are destroyed together with it; those of a swap chain are only unlinked.
+	AddressLookupTableObject *Container = nullptr;
+	AddressLookupTableObject *FirstChild = nullptr;
+	AddressLookupTableObject *NextSibling = nullptr;
+};
+
+// Reader/writer lock guarding a lookup table. It is only armed for devices created with
+// D3DCREATE_MULTITHREADED; every other device keeps the lock-free path and pays one branch.
+class AddressLock
+{
+public:
+	void Enable(bool Enabled) { Active = Enabled; }
+
+	void LockShared() { if (Active) AcquireSRWLockShared(&Lock); }
+	void UnlockShared() { if (Active) ReleaseSRWLockShared(&Lock); }
+	void LockExclusive() { if (Active) AcquireSRWLockExclusive(&Lock); }
+	void UnlockExclusive() { if (Active) ReleaseSRWLockExclusive(&Lock); }
+
+	class SharedGuard
+	{
+	public:
+		explicit SharedGuard(AddressLock &Lock) : Lock(Lock) { Lock.LockShared(); }
+		~SharedGuard() { Lock.UnlockShared(); }
+	private:
+		AddressLock &Lock;
+	};
+
+	class ExclusiveGuard
+	{
+	public:
+		explicit ExclusiveGuard(AddressLock &Lock) : Lock(Lock) { Lock.LockExclusive(); }
+		~ExclusiveGuard() { Lock.UnlockExclusive(); }
+	private:
+		AddressLock &Lock;
+	};
+
+private:
+	SRWLOCK Lock = SRWLOCK_INIT;
+	bool Active = false;
+};
 
 template <typename D>
 class AddressLookupTable
 {
 public:
-	explicit AddressLookupTable(D *pDevice) : pDevice(pDevice) {}
+	explicit AddressLookupTable(D *pDevice, bool Multithreaded = false) : pDevice(pDevice)
+	{
+		Lock.Enable(Multithreaded);
+	}
 	~AddressLookupTable()
 	{
 		ConstructorFlag = true;
 
+		// Wrapper memory belongs to the pools, which release their slabs in bulk after this
 		for (const auto& cache : g_map)
 		{
-			for (const auto& entry : cache)
-			{
-				entry.second->DeleteMe();
-			}
+			cache.ForEach([](void *, AddressLookupTableObject *Object) { Object->~AddressLookupTableObject(); });
 		}
 	}
 
 	template <typename T>
-	struct AddressCacheIndex { static constexpr UINT CacheIndex = 0; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3D9Ex> { static constexpr UINT CacheIndex = 1; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DDevice9Ex> { static constexpr UINT CacheIndex = 2; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DCubeTexture9> { static constexpr UINT CacheIndex = 3; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DIndexBuffer9> { static constexpr UINT CacheIndex = 4; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DPixelShader9> { static constexpr UINT CacheIndex = 5; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DQuery9> { static constexpr UINT CacheIndex = 6; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DStateBlock9> { static constexpr UINT CacheIndex = 7; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DSurface9> { static constexpr UINT CacheIndex = 8; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DSwapChain9Ex> { static constexpr UINT CacheIndex = 9; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DTexture9> { static constexpr UINT CacheIndex = 10; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVertexBuffer9> { static constexpr UINT CacheIndex = 11; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVertexDeclaration9> { static constexpr UINT CacheIndex = 12; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVertexShader9> { static constexpr UINT CacheIndex = 13; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVolume9> { static constexpr UINT CacheIndex = 14; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVolumeTexture9> { static constexpr UINT CacheIndex = 15; };
+	struct AddressCacheIndex
+	{
+		static constexpr UINT CacheIndex = IndexOfType<T, AddressCacheTypes>::Index;
+	};
 
 	m_IDirect3DSwapChain9Ex *CreateInterface(void *Proxy, REFIID riid)
 	{
-		return new m_IDirect3DSwapChain9Ex(static_cast<m_IDirect3DSwapChain9Ex*>(Proxy), pDevice, riid);
+		AddressLock::ExclusiveGuard Guard(Lock);
+		return ConstructInterface<m_IDirect3DSwapChain9Ex>(Proxy, riid);
 	}
 
 	template <typename T>
 	T *CreateInterface(void *Proxy)
 	{
-		return new T(static_cast<T *>(Proxy), pDevice);
+		AddressLock::ExclusiveGuard Guard(Lock);
+		return ConstructInterface<T>(Proxy);
+	}
+
+	template <typename T>
+	void DeleteInterface(T *Wrapper)
+	{
+		if (!Wrapper || ConstructorFlag)
+		{
+			return;
+		}
+
+		AddressLock::ExclusiveGuard Guard(Lock);
+		DestroyObject(Wrapper);
+	}
+
+	// Releases the proxy and destroys the wrapper once the last reference is gone. On a multithreaded
+	// device this runs under the exclusive lock, so no other thread can be handed the dying wrapper
+	// for a proxy address that the runtime has already freed and reused.
+	template <typename T, typename P>
+	ULONG ReleaseInterface(T *Wrapper, P *Proxy)
+	{
+		AddressLock::ExclusiveGuard Guard(Lock);
+
+		ULONG count = Proxy->Release();
+
+		if (count == 0 && !ConstructorFlag)
+		{
+			// A texture level shares its texture's reference count, so both are gone. A back buffer
+			// counts its own references, so only its wrapper goes and the swap chain stays.
+			AddressLookupTableObject *Object = Wrapper;
+			while (Object->Container && Object->Container->OwnsChildren())
+			{
+				Object = Object->Container;
+			}
+			DestroyObject(Object);
+		}
+
+		return count;
+	}
+
+	// Like FindAddress, but also links the wrapper to the wrapper of the object it was taken from, so
+	// the container is told through ForgetChild when the child goes away before it
+	template <typename T>
+	T *FindChild(void *Proxy, AddressLookupTableObject *Container)
+	{
+		T *Wrapper = FindAddress<T>(Proxy);
+
+		if (Wrapper && Wrapper->Container != Container)
+		{
+			AddressLock::ExclusiveGuard Guard(Lock);
+
+			if (Wrapper->Container != Container)
+			{
+				DetachChild(Wrapper);
+
+				Wrapper->Container = Container;
+				Wrapper->NextSibling = Container->FirstChild;
+				Container->FirstChild = Wrapper;
+			}
+		}
+
+		return Wrapper;
+	}
+
+	// Takes a reference to a child its container cached, under the shared lock, so a child released to zero on
+	// another thread is either still referenced or already gone from the slot. Returns nullptr in the latter case.
+	template <typename T>
+	T *AddRefCached(T *const &Slot)
+	{
+		AddressLock::SharedGuard Guard(Lock);
+
+		T *Wrapper = Slot;
+		if (Wrapper)
+		{
+			Wrapper->AddRef();
+		}
+		return Wrapper;
+	}
+
+	// Destroys the children of every wrapper of type T, e.g. the back buffers of all swap chains before a reset
+	template <typename T>
+	void ReleaseChildren()
+	{
+		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
+
+		AddressLock::ExclusiveGuard Guard(Lock);
+
+		g_map[CacheIndex].ForEach([this](void *, AddressLookupTableObject *Object)
+		{
+			while (AddressLookupTableObject *Child = Object->FirstChild)
+			{
+				DestroyObject(Child);
+			}
+		});
+	}
+
+	template <typename T>
+	WrapperPool::Statistics GetPoolStatistics()
+	{
+		AddressLock::SharedGuard Guard(Lock);
+		return g_pool[AddressCacheIndex<T>::CacheIndex].GetStatistics();
 	}
 
 	template <typename T>
@@ -76,31 +294,52 @@ public:
 		}
 
 		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
-		auto it = g_map[CacheIndex].find(Proxy);
+		AddressLookupTableObject *Object;
 
-		if (it != std::end(g_map[CacheIndex]))
 		{
-			return static_cast<T *>(it->second);
+			AddressLock::SharedGuard Guard(Lock);
+			Object = g_map[CacheIndex].Find(Proxy);
+		}
+
+		if (Object)
+		{
+			return static_cast<T *>(Object);
+		}
+
+		AddressLock::ExclusiveGuard Guard(Lock);
+
+		// Another thread may have wrapped the same proxy while the lock was released
+		Object = g_map[CacheIndex].Find(Proxy);
+		if (Object)
+		{
+			return static_cast<T *>(Object);
 		}
 
 		if (riid == IID_IUnknown)
 		{
-			return CreateInterface<T>(Proxy);
+			return ConstructInterface<T>(Proxy);
 		}
 		else
 		{
-			return (T*)CreateInterface(Proxy, riid);
+			return (T*)ConstructInterface<m_IDirect3DSwapChain9Ex>(Proxy, riid);
 		}
 	}
 
+	// Returns the wrapper already saved for Proxy, without creating one
 	template <typename T>
-	void SaveAddress(T *Wrapper, void *Proxy)
+	T *FindWrapper(void *Proxy)
 	{
 		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
-		if (Wrapper && Proxy)
-		{
-			g_map[CacheIndex][Proxy] = Wrapper;
-		}
+
+		AddressLock::SharedGuard Guard(Lock);
+		return static_cast<T *>(g_map[CacheIndex].Find(Proxy));
+	}
+
+	template <typename T>
+	void SaveAddress(T *Wrapper, void *Proxy)
+	{
+		AddressLock::ExclusiveGuard Guard(Lock);
+		InsertAddress(Wrapper, Proxy);
 	}
 
 	template <typename T>
@@ -111,29 +350,97 @@ public:
 			return;
 		}
 
+		AddressLock::ExclusiveGuard Guard(Lock);
+		RemoveAddress(Wrapper);
+	}
+
+private:
+	// The helpers below expect the caller to hold the exclusive lock
+
+	template <typename T>
+	void InsertAddress(T *Wrapper, void *Proxy)
+	{
 		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
-		auto it = std::find_if(g_map[CacheIndex].begin(), g_map[CacheIndex].end(),
-			[=](auto Map) -> bool { return Map.second == Wrapper; });
+		if (Wrapper && Proxy)
+		{
+			Wrapper->SetProxyAddress(Proxy);
+			g_map[CacheIndex].Insert(Proxy, Wrapper);
+		}
+	}
+
+	template <typename T>
+	void RemoveAddress(T *Wrapper)
+	{
+		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
+
+		// The proxy address may have been reused and saved for a newer wrapper
+		g_map[CacheIndex].Erase(Wrapper->GetProxyAddress(), Wrapper);
+	}
 
-		if (it != std::end(g_map[CacheIndex]))
+	void DetachChild(AddressLookupTableObject *Child)
+	{
+		AddressLookupTableObject *Container = Child->Container;
+		if (!Container)
+		{
+			return;
+		}
+
+		for (AddressLookupTableObject **Link = &Container->FirstChild; *Link; Link = &(*Link)->NextSibling)
 		{
-			it = g_map[CacheIndex].erase(it);
+			if (*Link == Child)
+			{
+				*Link = Child->NextSibling;
+				break;
+			}
 		}
+
+		Child->Container = nullptr;
+		Child->NextSibling = nullptr;
+		Container->ForgetChild(Child);
 	}
 
-private:
-	bool ConstructorFlag = false;
-	D *const pDevice;
-	std::unordered_map<void*, class AddressLookupTableObject*> g_map[MaxIndex];
-};
+	void DestroyObject(AddressLookupTableObject *Object)
+	{
+		// The container is going away as well, so its per-level caches need no updating
+		while (AddressLookupTableObject *Child = Object->FirstChild)
+		{
+			Object->FirstChild = Child->NextSibling;
+			Child->Container = nullptr;
+			Child->NextSibling = nullptr;
+			if (Object->OwnsChildren())
+			{
+				DestroyObject(Child);
+			}
+		}
 
-class AddressLookupTableObject
-{
-public:
-	virtual ~AddressLookupTableObject() { }
+		DetachChild(Object);
 
-	void DeleteMe()
+		const UINT CacheIndex = Object->CacheIndex;
+
+		// The proxy address may have been reused and saved for a newer wrapper
+		g_map[CacheIndex].Erase(Object->GetProxyAddress(), Object);
+
+		// The pool block starts at the most derived wrapper, not at this base
+		void *Block = dynamic_cast<void *>(Object);
+		Object->~AddressLookupTableObject();
+		g_pool[CacheIndex].Free(Block);
+	}
+
+	template <typename T, typename... Args>
+	T *ConstructInterface(void *Proxy, Args&&... args)
 	{
-		delete this;
+		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
+
+		T *Wrapper = new (g_pool[CacheIndex].Allocate(sizeof(T))) T(static_cast<T *>(Proxy), pDevice, std::forward<Args>(args)...);
+		static_cast<AddressLookupTableObject *>(Wrapper)->CacheIndex = CacheIndex;
+		InsertAddress(Wrapper, Proxy);
+
+		return Wrapper;
 	}
+
+	bool ConstructorFlag = false;
+	D *const pDevice;
+	AddressLock Lock;
+	WrapperPool g_pool[MaxIndex];
+	AddressMap<AddressLookupTableObject*> g_map[MaxIndex];
 };
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Open addressing hash table keyed by proxy address. Entries are stored inline in a single array
+// and probed linearly, so a lookup touches one or two cache lines instead of chasing a node pointer.
+// Removal shifts the following entries back into the hole, so no tombstones are ever left behind.
+template <typename V>
+class AddressMap
+{
+public:
+	struct Entry
+	{
+		void *Key;
+		V Value;
+	};
+
+	AddressMap() = default;
+	~AddressMap()
+	{
+		delete[] Table;
+	}
+
+	AddressMap(const AddressMap &) = delete;
+	AddressMap &operator=(const AddressMap &) = delete;
+
+	size_t Size() const { return Count; }
+	size_t Capacity() const { return Mask ? Mask + 1 : 0; }
+
+	V Find(void *Key) const
+	{
+		if (!Table || !Key)
+		{
+			return V();
+		}
+
+		for (size_t i = Hash(Key) & Mask; Table[i].Key; i = (i + 1) & Mask)
+		{
+			if (Table[i].Key == Key)
+			{
+				return Table[i].Value;
+			}
+		}
+
+		return V();
+	}
+
+	void Insert(void *Key, V Value)
+	{
+		if (!Key)
+		{
+			return;
+		}
+
+		if ((Count + 1) * 4 > Capacity() * 3)
+		{
+			Grow();
+		}
+
+		size_t i = Hash(Key) & Mask;
+		for (; Table[i].Key; i = (i + 1) & Mask)
+		{
+			if (Table[i].Key == Key)
+			{
+				Table[i].Value = Value;
+				return;
+			}
+		}
+
+		Table[i].Key = Key;
+		Table[i].Value = Value;
+		Count++;
+	}
+
+	// Removes the entry only if it still maps to Value
+	bool Erase(void *Key, V Value)
+	{
+		if (!Table || !Key)
+		{
+			return false;
+		}
+
+		size_t i = Hash(Key) & Mask;
+		for (; Table[i].Key != Key; i = (i + 1) & Mask)
+		{
+			if (!Table[i].Key)
+			{
+				return false;
+			}
+		}
+
+		if (Table[i].Value != Value)
+		{
+			return false;
+		}
+
+		// Backward shift: pull every following entry of the cluster that may legally occupy the hole
+		for (size_t j = (i + 1) & Mask; Table[j].Key; j = (j + 1) & Mask)
+		{
+			size_t Home = Hash(Table[j].Key) & Mask;
+			if (((j - Home) & Mask) >= ((j - i) & Mask))
+			{
+				Table[i] = Table[j];
+				i = j;
+			}
+		}
+
+		Table[i].Key = nullptr;
+		Table[i].Value = V();
+		Count--;
+
+		return true;
+	}
+
+	template <typename F>
+	void ForEach(F Func) const
+	{
+		for (size_t i = 0; i < Capacity(); i++)
+		{
+			if (Table[i].Key)
+			{
+				Func(Table[i].Key, Table[i].Value);
+			}
+		}
+	}
+
+private:
+	static constexpr size_t MinCapacity = 64;
+
+	static size_t Hash(void *Key)
+	{
+		// Fibonacci hashing; the upper half of the product mixes every bit of the address
+		return static_cast<size_t>((static_cast<uint64_t>(reinterpret_cast<uintptr_t>(Key)) * 0x9E3779B97F4A7C15ull) >> 32);
+	}
+
+	void Grow()
+	{
+		size_t OldCapacity = Capacity();
+		Entry *OldTable = Table;
+
+		size_t NewCapacity = OldCapacity ? OldCapacity * 2 : MinCapacity;
+		Table = new Entry[NewCapacity];
+		memset(Table, 0, NewCapacity * sizeof(Entry));
+		Mask = NewCapacity - 1;
+		Count = 0;
+
+		for (size_t i = 0; i < OldCapacity; i++)
+		{
+			if (OldTable[i].Key)
+			{
+				size_t j = Hash(OldTable[i].Key) & Mask;
+				while (Table[j].Key)
+				{
+					j = (j + 1) & Mask;
+				}
+				Table[j] = OldTable[i];
+				Count++;
+			}
+		}
+
+		delete[] OldTable;
+	}
+
+	Entry *Table = nullptr;
+	size_t Mask = 0;
+	size_t Count = 0;
+};
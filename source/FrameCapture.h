@@ -0,0 +1,279 @@
+#pragma once
+
+#include <atomic>
+#include <stdio.h>
+
+// One presented frame, as stored in a capture file
+struct FrameRecord
+{
+	LONGLONG Timestamp;		// Performance counter when the frame reached Present
+	float WaitMs;			// Limiter wait that preceded it
+	float CpuMs;			// Time the application spent on it, without the limiter wait
+	UINT SwapChain;			// Order in which the presenting swap chain first presented
+	UINT Reserved;
+};
+
+// Writes per-frame records to disk without ever making the presenting thread wait for it. Records go into a
+// single producer, single consumer ring; a writer thread drains it into a binary file and, once the capture is
+// stopped, optionally converts that file to CSV. Records that find the ring full are counted and dropped.
+// The header is brought up to date after every drain, so a capture cut short by the process exiting still
+// leaves a consistent binary file, only missing its last records and its CSV.
+// Start, Stop, Suspend, Poll and Push must all be called from the same (presenting) thread.
+class FrameCapture
+{
+public:
+	struct FileHeader
+	{
+		char Magic[4];			// "D9FC"
+		UINT Version;
+		LONGLONG Frequency;		// Performance counter ticks per second
+		ULONGLONG Records;		// Updated after every drain
+		ULONGLONG Dropped;
+	};
+
+	void Configure(const char* OutputDirectory, bool bConvertToCSV, int ToggleKey)
+	{
+		strncpy_s(Directory, OutputDirectory, _TRUNCATE);
+		bWriteCSV = bConvertToCSV;
+		nToggleKey = ToggleKey;
+	}
+
+	bool IsRunning() const { return bRunning; }
+
+	void Start()
+	{
+		if (bRunning)
+			return;
+
+		// The previous capture may still be draining or converting, it is left to finish
+		if (hWriter)
+		{
+			if (WaitForSingleObject(hWriter, 0) != WAIT_OBJECT_0)
+				return;
+			CloseHandle(hWriter);
+			hWriter = NULL;
+		}
+
+		SYSTEMTIME Time;
+		GetLocalTime(&Time);
+		_snprintf_s(FileName, _TRUNCATE, "%sd3d9_capture_%04u%02u%02u_%02u%02u%02u", Directory,
+			Time.wYear, Time.wMonth, Time.wDay, Time.wHour, Time.wMinute, Time.wSecond);
+
+		// A capture resumed within the same second gets a numbered name rather than overwriting the last one
+		size_t Length = strlen(FileName);
+		for (UINT n = 2; BinaryExists() && n < 100; n++)
+			_snprintf_s(FileName + Length, sizeof(FileName) - Length, _TRUNCATE, "_%u", n);
+
+		Head.store(0, std::memory_order_relaxed);
+		Tail.store(0, std::memory_order_relaxed);
+		Dropped.store(0, std::memory_order_relaxed);
+		bStop.store(false, std::memory_order_relaxed);
+
+		hWriter = CreateThread(NULL, 0, Writer, this, 0, NULL);
+		bRunning = hWriter != NULL;
+	}
+
+	void Stop()
+	{
+		if (!bRunning)
+			return;
+
+		bRunning = false;
+		bStop.store(true, std::memory_order_release);
+	}
+
+	// Stops a running capture when its device goes away. The writer completes the files on its own, and a new
+	// capture is started by Poll on the first frame after it is done, so nothing waits for the disk meanwhile.
+	void Suspend()
+	{
+		if (!bRunning)
+			return;
+
+		Stop();
+		bResume = true;
+	}
+
+	// Called once per frame: resumes a suspended capture, and starts or stops one on each press of the configured key
+	void Poll()
+	{
+		if (bResume)
+		{
+			Start();
+			bResume = !bRunning;
+		}
+
+		if (!nToggleKey)
+			return;
+
+		bool bDown = (GetAsyncKeyState(nToggleKey) & 0x8000) != 0;
+		if (bDown && !bKeyDown)
+		{
+			bResume = false;
+			if (bRunning)
+				Stop();
+			else
+				Start();
+		}
+		bKeyDown = bDown;
+	}
+
+	void Push(const FrameRecord& Record)
+	{
+		if (!bRunning)
+			return;
+
+		UINT head = Head.load(std::memory_order_relaxed);
+		if (head - Tail.load(std::memory_order_acquire) == Capacity)
+		{
+			Dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		Ring[head & (Capacity - 1)] = Record;
+		Head.store(head + 1, std::memory_order_release);
+	}
+
+	// Rewrites a binary capture as CSV: one line per frame, times in milliseconds from the first frame
+	static bool ConvertToCSV(const char* BinaryPath, const char* CSVPath)
+	{
+		FILE* In = nullptr;
+		FILE* Out = nullptr;
+		if (fopen_s(&In, BinaryPath, "rb") || !In)
+			return false;
+
+		FileHeader Header;
+		if (fread(&Header, sizeof(Header), 1, In) != 1 || memcmp(Header.Magic, "D9FC", 4) || !Header.Frequency ||
+			fopen_s(&Out, CSVPath, "w") || !Out)
+		{
+			fclose(In);
+			return false;
+		}
+
+		fprintf(Out, "frame,swapchain,time_ms,frametime_ms,wait_ms,cpu_ms\n");
+
+		// Frame times are measured against the previous frame of the same swap chain
+		LONGLONG Previous[16] = {};
+		LONGLONG First = 0;
+		FrameRecord Record;
+		for (ULONGLONG Frame = 0; fread(&Record, sizeof(Record), 1, In) == 1; Frame++)
+		{
+			if (!First)
+				First = Record.Timestamp;
+
+			LONGLONG& Last = Previous[Record.SwapChain % 16];
+			double FrameTime = Last ? (double)(Record.Timestamp - Last) * 1000.0 / (double)Header.Frequency : 0.0;
+			Last = Record.Timestamp;
+
+			fprintf(Out, "%llu,%u,%.4f,%.4f,%.4f,%.4f\n", Frame, Record.SwapChain,
+				(double)(Record.Timestamp - First) * 1000.0 / (double)Header.Frequency, FrameTime, Record.WaitMs, Record.CpuMs);
+		}
+
+		fclose(In);
+		fclose(Out);
+		return true;
+	}
+
+private:
+	static constexpr UINT Capacity = 4096;		// Power of two, about a minute of frames at 60 fps
+	static constexpr DWORD DrainInterval = 50;	// ms
+
+	bool BinaryExists() const
+	{
+		char BinaryPath[MAX_PATH + 16];
+		_snprintf_s(BinaryPath, _TRUNCATE, "%s.bin", FileName);
+		return GetFileAttributesA(BinaryPath) != INVALID_FILE_ATTRIBUTES;
+	}
+
+	static DWORD WINAPI Writer(LPVOID pParameter)
+	{
+		static_cast<FrameCapture*>(pParameter)->Write();
+		return 0;
+	}
+
+	void Write()
+	{
+		char BinaryPath[MAX_PATH + 16];
+		_snprintf_s(BinaryPath, _TRUNCATE, "%s.bin", FileName);
+
+		HANDLE hFile = CreateFileA(BinaryPath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			// Nothing to write to, so the ring is drained and discarded
+			while (!bStop.load(std::memory_order_acquire))
+			{
+				Tail.store(Head.load(std::memory_order_acquire), std::memory_order_release);
+				Sleep(DrainInterval);
+			}
+			return;
+		}
+
+		LARGE_INTEGER Frequency;
+		QueryPerformanceFrequency(&Frequency);
+
+		FileHeader Header = { { 'D', '9', 'F', 'C' }, 1, Frequency.QuadPart, 0, 0 };
+		DWORD Written;
+		WriteFile(hFile, &Header, sizeof(Header), &Written, NULL);
+
+		for (;;)
+		{
+			// Read the flag first, so that a drain after seeing it also gets the last records pushed before it
+			bool bLast = bStop.load(std::memory_order_acquire);
+
+			UINT tail = Tail.load(std::memory_order_relaxed);
+			UINT head = Head.load(std::memory_order_acquire);
+			bool bWritten = tail != head;
+			while (tail != head)
+			{
+				// Up to the end of the ring or the newest record, whichever comes first
+				UINT First = tail & (Capacity - 1);
+				UINT Count = head - tail;
+				if (Count > Capacity - First)
+					Count = Capacity - First;
+
+				WriteFile(hFile, &Ring[First], Count * sizeof(FrameRecord), &Written, NULL);
+				tail += Count;
+				Header.Records += Count;
+			}
+			Tail.store(tail, std::memory_order_release);
+
+			ULONGLONG dropped = Dropped.load(std::memory_order_relaxed);
+			if (bWritten || bLast || dropped != Header.Dropped)
+			{
+				Header.Dropped = dropped;
+				SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
+				WriteFile(hFile, &Header, sizeof(Header), &Written, NULL);
+				SetFilePointer(hFile, 0, NULL, FILE_END);
+			}
+
+			if (bLast)
+				break;
+
+			Sleep(DrainInterval);
+		}
+
+		CloseHandle(hFile);
+
+		if (bWriteCSV)
+		{
+			char CSVPath[MAX_PATH + 16];
+			_snprintf_s(CSVPath, _TRUNCATE, "%s.csv", FileName);
+			ConvertToCSV(BinaryPath, CSVPath);
+		}
+	}
+
+	FrameRecord Ring[Capacity] = {};
+	std::atomic<UINT> Head = 0;					// Written by the presenting thread
+	std::atomic<UINT> Tail = 0;					// Written by the writer thread
+	std::atomic<bool> bStop = false;
+
+	bool bRunning = false;
+	std::atomic<ULONGLONG> Dropped = 0;			// Written by the presenting thread
+	HANDLE hWriter = NULL;
+
+	char Directory[MAX_PATH] = {};
+	char FileName[MAX_PATH] = {};
+	bool bWriteCSV = false;
+	int nToggleKey = 0;
+	bool bKeyDown = false;
+	bool bResume = false;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "OverlayState.h"
+
+// On-screen graph of the last History frames: frame time, limiter wait and GPU time, each as a line.
+// Every sample adds one line segment per series to a dynamic vertex buffer used as a ring, appended with
+// D3DLOCK_NOOVERWRITE, so a frame normally writes nothing but its own segments. Vertices are placed by sample
+// number and frame time; the projection scrolls and scales them, so the scale can change without rewriting them.
+// Only when the ring is full, or the buffer is new, is it discarded and the whole history written again.
+// The buffer belongs to a single device at a time; it is created on first use and dropped by OnLostDevice().
+class FrameGraph
+{
+public:
+	enum Series { FrameTime, WaitTime, GpuTime, SeriesCount };
+
+	// Times in milliseconds, negative for a series not measured on this frame
+	void AddSample(float FrameMs, float WaitMs, float GpuMs)
+	{
+		float* Sample = Samples[Sequence % History];
+		Sample[FrameTime] = FrameMs;
+		Sample[WaitTime] = WaitMs;
+		Sample[GpuTime] = GpuMs;
+		Sequence++;
+	}
+
+	// Draws the graph into the given rectangle of a TargetWidth by TargetHeight render target, with MaxMs at its top edge
+	void Draw(IDirect3DDevice9* pDevice, UINT TargetWidth, UINT TargetHeight, float Left, float Top, float Width, float Height, float MaxMs)
+	{
+		if (Sequence < 2)
+			return;
+
+		if (pDevice != pBufferDevice)
+		{
+			OnLostDevice();
+			pBufferDevice = pDevice;
+		}
+		if (!pBuffer && FAILED(pDevice->CreateVertexBuffer(Capacity * sizeof(Vertex), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, FVF, D3DPOOL_DEFAULT, &pBuffer, NULL)))
+		{
+			pBuffer = nullptr;
+			return;
+		}
+		if ((!State.IsRecorded() && !State.Record(pDevice, [this](IDirect3DDevice9* pRecording) { SetState(pRecording); })) || !Write())
+			return;
+
+		// Sample n sits at x = n - Base, the newest one at the right edge of the rectangle
+		UINT Segments = (Sequence < History ? Sequence : History) - 1;
+		float Step = Width / (float)(History - 1);
+		float Newest = (float)(Sequence - 1 - Base);
+
+		// Row vector convention: clip = (x, y, z, 1) * Projection, over a viewport covering the whole target
+		D3DVIEWPORT9 Viewport = { 0, 0, TargetWidth, TargetHeight, 0.0f, 1.0f };
+		D3DMATRIX Projection = {};
+		Projection._11 = 2.0f * Step / (float)TargetWidth;
+		Projection._41 = 2.0f * (Left + Width - Newest * Step) / (float)TargetWidth - 1.0f;
+		Projection._22 = 2.0f * Height / MaxMs / (float)TargetHeight;
+		Projection._42 = 1.0f - 2.0f * (Top + Height) / (float)TargetHeight;
+		Projection._33 = 1.0f;
+		Projection._44 = 1.0f;
+
+		// Spikes past MaxMs would otherwise run up the screen
+		RECT Clip = { (LONG)Left, (LONG)Top, (LONG)(Left + Width), (LONG)(Top + Height) };
+
+		State.Begin();
+		pDevice->SetViewport(&Viewport);
+		pDevice->SetTransform(D3DTS_PROJECTION, &Projection);
+		pDevice->SetScissorRect(&Clip);
+		pDevice->DrawPrimitive(D3DPT_LINELIST, Cursor - Segments * SegmentVertices, Segments * SeriesCount);
+		State.End();
+	}
+
+	// Before Reset, the buffer is created and filled again on the next Draw
+	void OnLostDevice()
+	{
+		State.Release();
+		if (pBuffer)
+			pBuffer->Release();
+		pBuffer = nullptr;
+		pBufferDevice = nullptr;
+		Written = 0;
+	}
+
+private:
+	static constexpr UINT History = 256;
+	static constexpr UINT SegmentVertices = 2 * SeriesCount;			// One line per series between two samples
+	static constexpr UINT Capacity = 8 * History * SegmentVertices;		// Discarded once every 7 * History frames
+	static constexpr DWORD FVF = D3DFVF_XYZ | D3DFVF_DIFFUSE;
+
+	struct Vertex
+	{
+		float x, y, z;
+		D3DCOLOR Color;
+	};
+
+	// Appends the segments of the samples added since the last call, or starts the ring over with all of them
+	bool Write()
+	{
+		UINT Pending = Sequence - Written;
+		if (!Pending)
+			return true;
+
+		UINT First = Written;
+		DWORD Flags = D3DLOCK_NOOVERWRITE;
+		if (!Written || Pending >= History || Cursor + Pending * SegmentVertices > Capacity)
+		{
+			// The oldest segment still in the history ends at its second oldest sample
+			First = Sequence > History ? Sequence - History + 1 : 1;
+			Base = First - 1;
+			Cursor = 0;
+			Flags = D3DLOCK_DISCARD;
+		}
+
+		UINT Count = (Sequence - First) * SegmentVertices;
+		Vertex* v = nullptr;
+		if (FAILED(pBuffer->Lock(Cursor * sizeof(Vertex), Count * sizeof(Vertex), (void**)&v, Flags)) || !v)
+		{
+			Written = 0;
+			return false;
+		}
+
+		for (UINT n = First; n < Sequence; n++)
+		{
+			const float* Previous = Samples[(n - 1) % History];
+			const float* Current = Samples[n % History];
+			float x0 = (float)(n - 1 - Base), x1 = (float)(n - Base);
+
+			for (UINT s = 0; s < SeriesCount; s++)
+			{
+				// A series missing on either end is written anyway, fully transparent, so segments stay aligned
+				D3DCOLOR Color = Previous[s] >= 0.0f && Current[s] >= 0.0f ? Colors[s] : 0;
+				*v++ = { x0, Clamp(Previous[s]), 0.0f, Color };
+				*v++ = { x1, Clamp(Current[s]), 0.0f, Color };
+			}
+		}
+
+		pBuffer->Unlock();
+		Cursor += Count;
+		Written = Sequence;
+		return true;
+	}
+
+	static float Clamp(float Ms)
+	{
+		return Ms < 0.0f ? 0.0f : Ms > 1000.0f ? 1000.0f : Ms;
+	}
+
+	// Fixed function, untransformed and unlit vertices colored by their diffuse alone, clipped to the scissor rect
+	void SetState(IDirect3DDevice9* pDevice)
+	{
+		static const D3DMATRIX Identity = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+		pDevice->SetVertexShader(NULL);
+		pDevice->SetPixelShader(NULL);
+		pDevice->SetFVF(FVF);
+		pDevice->SetStreamSource(0, pBuffer, 0, sizeof(Vertex));
+		pDevice->SetTexture(0, NULL);
+		pDevice->SetTransform(D3DTS_WORLD, &Identity);
+		pDevice->SetTransform(D3DTS_VIEW, &Identity);
+		pDevice->SetTransform(D3DTS_PROJECTION, &Identity);
+		D3DVIEWPORT9 Viewport = { 0, 0, 1, 1, 0.0f, 1.0f };
+		pDevice->SetViewport(&Viewport);
+		RECT Clip = {};
+		pDevice->SetScissorRect(&Clip);
+
+		pDevice->SetRenderState(D3DRS_LIGHTING, FALSE);
+		pDevice->SetRenderState(D3DRS_VERTEXBLEND, D3DVBF_DISABLE);
+		pDevice->SetRenderState(D3DRS_INDEXEDVERTEXBLENDENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_CLIPPING, TRUE);
+		pDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+		pDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+		pDevice->SetRenderState(D3DRS_SEPARATEALPHABLENDENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+		pDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+		pDevice->SetRenderState(D3DRS_BLENDOP, D3DBLENDOP_ADD);
+		pDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+		pDevice->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
+		pDevice->SetRenderState(D3DRS_ANTIALIASEDLINEENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_SCISSORTESTENABLE, TRUE);
+		pDevice->SetRenderState(D3DRS_CLIPPLANEENABLE, 0);
+		pDevice->SetRenderState(D3DRS_FOGENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+		pDevice->SetRenderState(D3DRS_SRGBWRITEENABLE, FALSE);
+
+		pDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+		pDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+		pDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+		pDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+		pDevice->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+		pDevice->SetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+	}
+
+	static constexpr D3DCOLOR Colors[SeriesCount] =
+	{
+		D3DCOLOR_XRGB(0xF7, 0xF7, 0),		// Frame time, the counter's yellow
+		D3DCOLOR_XRGB(0, 0xC0, 0xF7),		// Limiter wait
+		D3DCOLOR_XRGB(0xF7, 0, 0xF7),		// GPU time
+	};
+
+	float Samples[History][SeriesCount] = {};
+	UINT Sequence = 0;					// Samples added so far
+	UINT Written = 0;					// Samples whose segments are in the buffer, 0 when it has to be filled anew
+	UINT Base = 0;						// Sample at x = 0
+	UINT Cursor = 0;					// Next free vertex
+
+	IDirect3DDevice9* pBufferDevice = nullptr;
+	IDirect3DVertexBuffer9* pBuffer = nullptr;
+	OverlayState State;
+};
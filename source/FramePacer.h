@@ -0,0 +1,53 @@
+#pragma once
+
+#include <math.h>
+
+// Frame schedule on absolute deadlines. Frame n is due at Base + n * Period, so however late a
+// single frame is released, the error never carries over into the following ones and the long
+// term rate matches the target exactly, fractional targets such as 59.94 included.
+// Time is passed in by the caller in performance counter ticks, which keeps the class free of
+// any clock and lets it be driven by a simulated one.
+class FramePacer
+{
+public:
+	void Start(double FramesPerSecond, LONGLONG Frequency, LONGLONG Now)
+	{
+		Period = (double)Frequency / FramesPerSecond;
+		Rebase(Now);
+		Resyncs = 0;
+	}
+
+	LONGLONG GetDeadline() const { return Deadline; }
+	LONGLONG GetPeriod() const { return (LONGLONG)Period; }
+	UINT GetResyncs() const { return Resyncs; }
+
+	// Moves on to the next frame once the current one has been released at Now
+	void Advance(LONGLONG Now)
+	{
+		// After a stall of more than a whole frame, catching up would mean presenting a burst of
+		// frames back to back, so the schedule starts over from the current time instead
+		if (Now - Deadline > (LONGLONG)Period)
+		{
+			Rebase(Now);
+			Resyncs++;
+			return;
+		}
+
+		Frame++;
+		Deadline = Base + (LONGLONG)llround((double)Frame * Period);
+	}
+
+private:
+	void Rebase(LONGLONG Now)
+	{
+		Base = Now;
+		Frame = 1;
+		Deadline = Base + (LONGLONG)llround(Period);
+	}
+
+	double Period = 0.0;
+	LONGLONG Base = 0;
+	ULONGLONG Frame = 0;
+	LONGLONG Deadline = 0;
+	UINT Resyncs = 0;
+};
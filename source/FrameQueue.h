@@ -0,0 +1,108 @@
+#pragma once
+
+// Caps how many frames the driver may queue ahead of the GPU, for plain devices as well as Ex ones, which are
+// the only ones offering SetMaximumFrameLatency. An event query is issued after every Present and, before the
+// next one, the query issued Depth presents ago is waited on, so no more than Depth frames are ever in flight.
+// The queries belong to a single device at a time; they are created on first use and dropped by Release().
+class FrameQueue
+{
+public:
+	static constexpr UINT MaxDepth = 8;
+
+	void SetDepth(UINT Frames)
+	{
+		Release();
+		Depth = Frames > MaxDepth ? MaxDepth : Frames;
+	}
+
+	UINT GetDepth() const { return Depth; }
+	double GetWaitMsPerFrame() const { return WaitMsPerFrame; }
+
+	// Before Present: blocks until the GPU is done with the frame presented Depth frames ago
+	void Wait(IDirect3DDevice9* pDevice)
+	{
+		if (!Depth || pDevice != pQueryDevice || !Queries[Next] || !bIssued[Next])
+			return;
+
+		LARGE_INTEGER Start, End;
+		QueryPerformanceCounter(&Start);
+
+		// Anything but S_FALSE ends the wait, a lost device never signals its queries
+		while (Queries[Next]->GetData(NULL, 0, D3DGETDATA_FLUSH) == S_FALSE)
+			SwitchToThread();
+		bIssued[Next] = false;
+
+		QueryPerformanceCounter(&End);
+		Record(End.QuadPart - Start.QuadPart, End.QuadPart);
+	}
+
+	// After Present: marks the end of the frame just handed to the runtime
+	void Issue(IDirect3DDevice9* pDevice)
+	{
+		if (!Depth)
+			return;
+
+		if (pDevice != pQueryDevice)
+		{
+			Release();
+			pQueryDevice = pDevice;
+		}
+
+		if (!Queries[Next] && FAILED(pDevice->CreateQuery(D3DQUERYTYPE_EVENT, &Queries[Next])))
+		{
+			Queries[Next] = nullptr;
+			return;
+		}
+
+		bIssued[Next] = SUCCEEDED(Queries[Next]->Issue(D3DISSUE_END));
+		Next = (Next + 1) % Depth;
+	}
+
+	void Release()
+	{
+		for (UINT i = 0; i < MaxDepth; i++)
+		{
+			if (Queries[i])
+				Queries[i]->Release();
+			Queries[i] = nullptr;
+			bIssued[i] = false;
+		}
+		pQueryDevice = nullptr;
+		Next = 0;
+	}
+
+private:
+	// Averages the wait over one second windows, like the frame limiter's own statistics
+	void Record(LONGLONG Ticks, LONGLONG Now)
+	{
+		WAIT_Ticks += Ticks;
+		WAIT_Frames++;
+
+		if (!WAIT_WindowStart)
+		{
+			WAIT_WindowStart = Now;
+			return;
+		}
+
+		LARGE_INTEGER Frequency;
+		QueryPerformanceFrequency(&Frequency);
+		if (Now - WAIT_WindowStart >= Frequency.QuadPart)
+		{
+			WaitMsPerFrame = (double)WAIT_Ticks * 1000.0 / (double)Frequency.QuadPart / (double)WAIT_Frames;
+			WAIT_WindowStart = Now;
+			WAIT_Ticks = 0;
+			WAIT_Frames = 0;
+		}
+	}
+
+	UINT Depth = 0;
+	UINT Next = 0;
+	IDirect3DDevice9* pQueryDevice = nullptr;
+	IDirect3DQuery9* Queries[MaxDepth] = {};
+	bool bIssued[MaxDepth] = {};
+
+	LONGLONG WAIT_WindowStart = 0;
+	LONGLONG WAIT_Ticks = 0;
+	UINT WAIT_Frames = 0;
+	double WaitMsPerFrame = 0.0;
+};
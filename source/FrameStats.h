@@ -0,0 +1,184 @@
+#pragma once
+
+#include <math.h>
+
+// Frame time statistics over the last Capacity frames, in fixed storage so recording a frame never allocates.
+// Mean and deviation come from running sums, minimum and maximum from monotonic queues, and the slow frame
+// percentiles from a histogram of the window with 0.1ms buckets, so every query is cheap enough for each frame.
+// The "1% low" is the frame rate at the 99th percentile frame time, the "0.1% low" the one at the 99.9th.
+template <UINT Capacity = 1024>
+class FrameStats
+{
+	static_assert(Capacity > 0 && Capacity <= 0xFFFF, "histogram buckets count frames in 16 bits");
+
+public:
+	struct Summary
+	{
+		UINT Frames;
+		double MinMs;
+		double MaxMs;
+		double MeanMs;
+		double StdDevMs;
+		double P99Ms;		// 1% of the frames took at least this long
+		double P999Ms;		// 0.1% of the frames took at least this long
+	};
+
+	// Records the frame that ended at Now, both in performance counter ticks
+	void AddTimestamp(LONGLONG Now, LONGLONG Frequency)
+	{
+		if (LastTimestamp)
+			AddFrameTime((double)(Now - LastTimestamp) * 1000.0 / (double)Frequency);
+		LastTimestamp = Now;
+	}
+
+	void AddFrameTime(double Ms)
+	{
+		if (Count == Capacity)
+			Evict();
+
+		UINT Slot = (First + Count) % Capacity;
+		Times[Slot] = Ms;
+		Count++;
+
+		Sum += Ms;
+		SumSq += Ms * Ms;
+		Histogram[Bucket(Ms)]++;
+
+		// Drop queue entries the new frame dominates, the fronts then hold the window's extremes
+		while (MinCount && Times[MinQueue[(MinFirst + MinCount - 1) % Capacity]] >= Ms)
+			MinCount--;
+		MinQueue[(MinFirst + MinCount++) % Capacity] = Slot;
+		while (MaxCount && Times[MaxQueue[(MaxFirst + MaxCount - 1) % Capacity]] <= Ms)
+			MaxCount--;
+		MaxQueue[(MaxFirst + MaxCount++) % Capacity] = Slot;
+
+		// Subtracting evicted frames leaves rounding behind, so the sums are rebuilt once per window
+		if (++SinceResum >= Capacity)
+			Resum();
+	}
+
+	void Reset()
+	{
+		*this = FrameStats();
+	}
+
+	UINT GetFrames() const { return Count; }
+
+	// Mean of the most recent Frames frame times, for a counter that follows changes faster than the full window
+	double GetRecentMeanMs(UINT Frames) const
+	{
+		if (Frames > Count)
+			Frames = Count;
+		if (!Frames)
+			return 0.0;
+
+		double Total = 0.0;
+		for (UINT i = Count - Frames; i < Count; i++)
+			Total += Times[(First + i) % Capacity];
+		return Total / (double)Frames;
+	}
+
+	Summary GetSummary() const
+	{
+		Summary s = {};
+		s.Frames = Count;
+		if (!Count)
+			return s;
+
+		s.MinMs = Times[MinQueue[MinFirst]];
+		s.MaxMs = Times[MaxQueue[MaxFirst]];
+		s.MeanMs = Sum / (double)Count;
+		double Variance = SumSq / (double)Count - s.MeanMs * s.MeanMs;
+		s.StdDevMs = Variance > 0.0 ? sqrt(Variance) : 0.0;
+		s.P99Ms = Percentile(0.01, s.MinMs, s.MaxMs);
+		s.P999Ms = Percentile(0.001, s.MinMs, s.MaxMs);
+		return s;
+	}
+
+private:
+	static constexpr UINT Buckets = 2000;			// 0.1ms each, the last one also holds anything slower
+	static constexpr double BucketMs = 0.1;
+
+	static UINT Bucket(double Ms)
+	{
+		if (Ms <= 0.0)
+			return 0;
+		UINT b = (UINT)(Ms / BucketMs);
+		return b < Buckets ? b : Buckets - 1;
+	}
+
+	// Frame time that the slowest Fraction of the window reaches, to bucket resolution and clamped to the observed range
+	double Percentile(double Fraction, double MinMs, double MaxMs) const
+	{
+		UINT Wanted = (UINT)ceil(Fraction * (double)Count);
+		if (Wanted < 1)
+			Wanted = 1;
+
+		UINT Seen = 0;
+		for (UINT b = Buckets; b-- > 0;)
+		{
+			Seen += Histogram[b];
+			if (Seen >= Wanted)
+			{
+				if (b == Buckets - 1)
+					return MaxMs;
+				double Ms = ((double)b + 0.5) * BucketMs;
+				return Ms < MinMs ? MinMs : Ms > MaxMs ? MaxMs : Ms;
+			}
+		}
+		return MaxMs;
+	}
+
+	void Evict()
+	{
+		double Ms = Times[First];
+		Sum -= Ms;
+		SumSq -= Ms * Ms;
+		Histogram[Bucket(Ms)]--;
+
+		if (MinCount && MinQueue[MinFirst] == First)
+		{
+			MinFirst = (MinFirst + 1) % Capacity;
+			MinCount--;
+		}
+		if (MaxCount && MaxQueue[MaxFirst] == First)
+		{
+			MaxFirst = (MaxFirst + 1) % Capacity;
+			MaxCount--;
+		}
+
+		First = (First + 1) % Capacity;
+		Count--;
+	}
+
+	void Resum()
+	{
+		Sum = 0.0;
+		SumSq = 0.0;
+		for (UINT i = 0; i < Count; i++)
+		{
+			double Ms = Times[(First + i) % Capacity];
+			Sum += Ms;
+			SumSq += Ms * Ms;
+		}
+		SinceResum = 0;
+	}
+
+	double Times[Capacity] = {};
+	UINT First = 0;
+	UINT Count = 0;
+
+	// Slots of Times, in frame order, with increasing (MinQueue) or decreasing (MaxQueue) frame times
+	UINT MinQueue[Capacity] = {};
+	UINT MinFirst = 0;
+	UINT MinCount = 0;
+	UINT MaxQueue[Capacity] = {};
+	UINT MaxFirst = 0;
+	UINT MaxCount = 0;
+
+	unsigned short Histogram[Buckets] = {};
+	double Sum = 0.0;
+	double SumSq = 0.0;
+	UINT SinceResum = 0;
+	LONGLONG LastTimestamp = 0;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "FrameStats.h"
+
+// Measures how long the GPU spends on each frame, from a timestamp taken after one Present to a timestamp taken
+// before the next. Both are bracketed by a TIMESTAMPDISJOINT query and come with the TIMESTAMPFREQ they count in.
+// Frames go into a ring of Depth query sets that are only read back once the GPU is done with them, so the CPU never
+// waits: a frame that finds the next set still in flight is simply not measured. Frames the disjoint query flags
+// (the GPU clock changed or the counter was reset) are reported as disjoint rather than given a time, and devices
+// that cannot create the queries as unsupported.
+// The queries belong to a single device at a time; they are created on first use and dropped by Release().
+class GpuTimer
+{
+public:
+	enum Result { None, Valid, Disjoint, Unsupported };
+	static constexpr UINT Depth = 4;
+
+	Result GetLastResult() const { return LastResult; }
+	double GetLastMs() const { return LastMs; }
+	UINT GetDisjointFrames() const { return DisjointFrames; }
+	const FrameStats<>& GetStats() const { return Stats; }			// Valid frames only
+
+	// After Present: the next frame starts
+	void BeginFrame(IDirect3DDevice9* pDevice)
+	{
+		if (pDevice != pQueryDevice)
+		{
+			Release();
+			pQueryDevice = pDevice;
+			LastResult = None;
+		}
+		if (LastResult == Unsupported)
+			return;
+
+		Collect();
+
+		// Still in flight since Depth frames ago, this frame goes unmeasured
+		QuerySet& Set = Sets[Next];
+		if (Set.bIssued)
+			return;
+		if (!Set.pDisjoint && !Create(Set))
+		{
+			Release();
+			pQueryDevice = pDevice;
+			LastResult = Unsupported;
+			return;
+		}
+
+		// Also starts over a frame that was never ended, when the overlay was switched off or the Present skipped
+		Set.pDisjoint->Issue(D3DISSUE_BEGIN);
+		Set.pStart->Issue(D3DISSUE_END);
+		bOpen = true;
+	}
+
+	// Before Present: the frame ends, its results are read back on a later BeginFrame
+	void EndFrame(IDirect3DDevice9* pDevice)
+	{
+		if (!bOpen || pDevice != pQueryDevice)
+			return;
+
+		QuerySet& Set = Sets[Next];
+		Set.pEnd->Issue(D3DISSUE_END);
+		Set.pFrequency->Issue(D3DISSUE_END);
+		Set.pDisjoint->Issue(D3DISSUE_END);
+		Set.bIssued = true;
+		bOpen = false;
+		Next = (Next + 1) % Depth;
+	}
+
+	void Release()
+	{
+		for (QuerySet& Set : Sets)
+		{
+			IDirect3DQuery9** Queries[] = { &Set.pDisjoint, &Set.pFrequency, &Set.pStart, &Set.pEnd };
+			for (IDirect3DQuery9** ppQuery : Queries)
+			{
+				if (*ppQuery)
+					(*ppQuery)->Release();
+				*ppQuery = nullptr;
+			}
+			Set.bIssued = false;
+		}
+		pQueryDevice = nullptr;
+		Next = 0;
+		bOpen = false;
+	}
+
+private:
+	struct QuerySet
+	{
+		IDirect3DQuery9* pDisjoint;
+		IDirect3DQuery9* pFrequency;
+		IDirect3DQuery9* pStart;
+		IDirect3DQuery9* pEnd;
+		bool bIssued;
+	};
+
+	bool Create(QuerySet& Set)
+	{
+		if (FAILED(pQueryDevice->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, &Set.pDisjoint)) ||
+			FAILED(pQueryDevice->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, &Set.pFrequency)) ||
+			FAILED(pQueryDevice->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &Set.pStart)) ||
+			FAILED(pQueryDevice->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &Set.pEnd)))
+			return false;
+		return Set.pDisjoint && Set.pFrequency && Set.pStart && Set.pEnd;
+	}
+
+	// Reads back finished sets, oldest first, without flushing or waiting
+	void Collect()
+	{
+		for (UINT i = 0; i < Depth; i++)
+		{
+			QuerySet& Set = Sets[(Next + i) % Depth];
+			if (!Set.bIssued)
+				continue;
+
+			BOOL bDisjoint = FALSE;
+			UINT64 Frequency = 0, Start = 0, End = 0;
+			HRESULT hr = Set.pDisjoint->GetData(&bDisjoint, sizeof(bDisjoint), 0);
+			if (hr == S_OK)
+				hr = Set.pFrequency->GetData(&Frequency, sizeof(Frequency), 0);
+			if (hr == S_OK)
+				hr = Set.pStart->GetData(&Start, sizeof(Start), 0);
+			if (hr == S_OK)
+				hr = Set.pEnd->GetData(&End, sizeof(End), 0);
+
+			// Later sets are still in flight too
+			if (hr == S_FALSE)
+				return;
+
+			// Anything else than S_OK, a lost device for one, leaves nothing to report
+			Set.bIssued = false;
+			if (hr != S_OK)
+				continue;
+
+			if (bDisjoint || !Frequency || End < Start)
+			{
+				LastResult = Disjoint;
+				DisjointFrames++;
+				continue;
+			}
+
+			LastResult = Valid;
+			LastMs = (double)(End - Start) * 1000.0 / (double)Frequency;
+			Stats.AddFrameTime(LastMs);
+		}
+	}
+
+	QuerySet Sets[Depth] = {};
+	UINT Next = 0;
+	bool bOpen = false;
+	IDirect3DDevice9* pQueryDevice = nullptr;
+
+	Result LastResult = None;
+	double LastMs = 0.0;
+	UINT DisjointFrames = 0;
+	FrameStats<> Stats;
+};
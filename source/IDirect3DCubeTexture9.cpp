@@ -44,7 +44,7 @@ ULONG m_IDirect3DCubeTexture9::AddRef(THIS)
 
 ULONG m_IDirect3DCubeTexture9::Release(THIS)
 {
-	return ProxyInterface->Release();
+	return m_pDeviceEx->ProxyAddressLookupTable->ReleaseInterface(this, ProxyInterface);
 }
 
 HRESULT m_IDirect3DCubeTexture9::GetDevice(THIS_ IDirect3DDevice9** ppDevice)
@@ -93,7 +93,7 @@ void m_IDirect3DCubeTexture9::PreLoad(THIS)
 
 D3DRESOURCETYPE m_IDirect3DCubeTexture9::GetType(THIS)
 {
-	return ProxyInterface->GetType();
+	return GetResourceType();
 }
 
 DWORD m_IDirect3DCubeTexture9::SetLOD(THIS_ DWORD LODNew)
@@ -133,16 +133,48 @@ HRESULT m_IDirect3DCubeTexture9::GetLevelDesc(THIS_ UINT Level, D3DSURFACE_DESC
 
 HRESULT m_IDirect3DCubeTexture9::GetCubeMapSurface(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface9** ppCubeMapSurface)
 {
+	const bool Cacheable = (UINT)FaceType < 6 && Level < MaxCachedLevels;
+
+	if (Cacheable && CubeMapSurfaces[FaceType][Level] && ppCubeMapSurface)
+	{
+		CubeMapSurfaces[FaceType][Level]->AddRef();
+
+		*ppCubeMapSurface = CubeMapSurfaces[FaceType][Level];
+
+		return D3D_OK;
+	}
+
 	HRESULT hr = ProxyInterface->GetCubeMapSurface(FaceType, Level, ppCubeMapSurface);
 
 	if (SUCCEEDED(hr) && ppCubeMapSurface)
 	{
-		*ppCubeMapSurface = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface9>(*ppCubeMapSurface);
+		m_IDirect3DSurface9 *pSurface = m_pDeviceEx->ProxyAddressLookupTable->FindChild<m_IDirect3DSurface9>(*ppCubeMapSurface, this);
+
+		if (Cacheable)
+		{
+			CubeMapSurfaces[FaceType][Level] = pSurface;
+		}
+
+		*ppCubeMapSurface = pSurface;
 	}
 
 	return hr;
 }
 
+void m_IDirect3DCubeTexture9::ForgetChild(AddressLookupTableObject *Child)
+{
+	for (auto &Face : CubeMapSurfaces)
+	{
+		for (m_IDirect3DSurface9 *&pSurface : Face)
+		{
+			if (pSurface && static_cast<AddressLookupTableObject *>(pSurface) == Child)
+			{
+				pSurface = nullptr;
+			}
+		}
+	}
+}
+
 HRESULT m_IDirect3DCubeTexture9::LockRect(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
 {
 	return ProxyInterface->LockRect(FaceType, Level, pLockedRect, pRect, Flags);
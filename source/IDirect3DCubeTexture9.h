@@ -5,12 +5,13 @@ class m_IDirect3DCubeTexture9 : public IDirect3DCubeTexture9, public AddressLook
 private:
 	LPDIRECT3DCUBETEXTURE9 ProxyInterface;
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
+	m_IDirect3DSurface9* CubeMapSurfaces[6][MaxCachedLevels] = {};
+
+protected:
+	void ForgetChild(AddressLookupTableObject *Child) override;
 
 public:
-	m_IDirect3DCubeTexture9(LPDIRECT3DCUBETEXTURE9 pTexture9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pTexture9), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DCubeTexture9(LPDIRECT3DCUBETEXTURE9 pTexture9, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_CUBETEXTURE), ProxyInterface(pTexture9), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DCubeTexture9() {}
 
 	LPDIRECT3DCUBETEXTURE9 GetProxyInterface() { return ProxyInterface; }
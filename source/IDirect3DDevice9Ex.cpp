@@ -39,30 +39,32 @@ HRESULT m_IDirect3DDevice9Ex::QueryInterface(REFIID riid, void** ppvObj)
 
 ULONG m_IDirect3DDevice9Ex::AddRef()
 {
+	InterlockedIncrement(&AppRefCount);
+
 	return ProxyInterface->AddRef();
 }
 
-ULONG m_IDirect3DDevice9Ex::Release()
-{
-	ULONG count = ProxyInterface->Release();
-
-	if (count == 0)
-	{
-		delete this;
-	}
-
-	return count;
-}
+//ULONG m_IDirect3DDevice9Ex::Release()
+//{
+//	ULONG count = ProxyInterface->Release();
+//
+//	if (count == 0)
+//	{
+//		delete this;
+//	}
+//
+//	return count;
+//}
 
 //HRESULT m_IDirect3DDevice9Ex::Reset(D3DPRESENT_PARAMETERS *pPresentationParameters)
 //{
 //	return ProxyInterface->Reset(pPresentationParameters);
 //}
 
-//HRESULT m_IDirect3DDevice9Ex::EndScene()
-//{
-//	return ProxyInterface->EndScene();
-//}
+HRESULT m_IDirect3DDevice9Ex::EndScene()
+{
+	return ProxyInterface->EndScene();
+}
 
 void m_IDirect3DDevice9Ex::SetCursorPosition(int X, int Y, DWORD Flags)
 {
@@ -71,7 +73,7 @@ void m_IDirect3DDevice9Ex::SetCursorPosition(int X, int Y, DWORD Flags)
 
 HRESULT m_IDirect3DDevice9Ex::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9 *pCursorBitmap)
 {
-	if (pCursorBitmap)
+	if (pCursorBitmap && WrapResources)
 	{
 		pCursorBitmap = static_cast<m_IDirect3DSurface9 *>(pCursorBitmap)->GetProxyInterface();
 	}
@@ -90,7 +92,7 @@ HRESULT m_IDirect3DDevice9Ex::CreateAdditionalSwapChain(D3DPRESENT_PARAMETERS *p
 
 	if (SUCCEEDED(hr) && ppSwapChain)
 	{
-		*ppSwapChain = new m_IDirect3DSwapChain9Ex((IDirect3DSwapChain9Ex*)*ppSwapChain, this);
+		*ppSwapChain = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSwapChain9Ex>(*ppSwapChain);
 	}
 
 	return hr;
@@ -100,9 +102,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateCubeTexture(THIS_ UINT EdgeLength, UINT Leve
 {
 	HRESULT hr = ProxyInterface->CreateCubeTexture(EdgeLength, Levels, Usage, Format, Pool, ppCubeTexture, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppCubeTexture)
+	if (SUCCEEDED(hr) && ppCubeTexture && WrapResources)
 	{
-		*ppCubeTexture = new m_IDirect3DCubeTexture9(*ppCubeTexture, this);
+		*ppCubeTexture = ProxyAddressLookupTable->CreateInterface<m_IDirect3DCubeTexture9>(*ppCubeTexture);
 	}
 
 	return hr;
@@ -112,9 +114,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateDepthStencilSurface(THIS_ UINT Width, UINT H
 {
 	HRESULT hr = ProxyInterface->CreateDepthStencilSurface(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppSurface)
+	if (SUCCEEDED(hr) && ppSurface && WrapResources)
 	{
-		*ppSurface = new m_IDirect3DSurface9(*ppSurface, this);
+		*ppSurface = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSurface9>(*ppSurface);
 	}
 
 	return hr;
@@ -124,9 +126,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateIndexBuffer(THIS_ UINT Length, DWORD Usage,
 {
 	HRESULT hr = ProxyInterface->CreateIndexBuffer(Length, Usage, Format, Pool, ppIndexBuffer, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppIndexBuffer)
+	if (SUCCEEDED(hr) && ppIndexBuffer && WrapResources)
 	{
-		*ppIndexBuffer = new m_IDirect3DIndexBuffer9(*ppIndexBuffer, this);
+		*ppIndexBuffer = ProxyAddressLookupTable->CreateInterface<m_IDirect3DIndexBuffer9>(*ppIndexBuffer);
 	}
 
 	return hr;
@@ -136,9 +138,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateRenderTarget(THIS_ UINT Width, UINT Height,
 {
 	HRESULT hr = ProxyInterface->CreateRenderTarget(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppSurface)
+	if (SUCCEEDED(hr) && ppSurface && WrapResources)
 	{
-		*ppSurface = new m_IDirect3DSurface9(*ppSurface, this);
+		*ppSurface = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSurface9>(*ppSurface);
 	}
 
 	return hr;
@@ -148,9 +150,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateTexture(THIS_ UINT Width, UINT Height, UINT
 {
 	HRESULT hr = ProxyInterface->CreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppTexture)
+	if (SUCCEEDED(hr) && ppTexture && WrapResources)
 	{
-		*ppTexture = new m_IDirect3DTexture9(*ppTexture, this);
+		*ppTexture = ProxyAddressLookupTable->CreateInterface<m_IDirect3DTexture9>(*ppTexture);
 	}
 
 	return hr;
@@ -160,9 +162,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateVertexBuffer(THIS_ UINT Length, DWORD Usage,
 {
 	HRESULT hr = ProxyInterface->CreateVertexBuffer(Length, Usage, FVF, Pool, ppVertexBuffer, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppVertexBuffer)
+	if (SUCCEEDED(hr) && ppVertexBuffer && WrapResources)
 	{
-		*ppVertexBuffer = new m_IDirect3DVertexBuffer9(*ppVertexBuffer, this);
+		*ppVertexBuffer = ProxyAddressLookupTable->CreateInterface<m_IDirect3DVertexBuffer9>(*ppVertexBuffer);
 	}
 
 	return hr;
@@ -172,9 +174,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateVolumeTexture(THIS_ UINT Width, UINT Height,
 {
 	HRESULT hr = ProxyInterface->CreateVolumeTexture(Width, Height, Depth, Levels, Usage, Format, Pool, ppVolumeTexture, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppVolumeTexture)
+	if (SUCCEEDED(hr) && ppVolumeTexture && WrapResources)
 	{
-		*ppVolumeTexture = new m_IDirect3DVolumeTexture9(*ppVolumeTexture, this);
+		*ppVolumeTexture = ProxyAddressLookupTable->CreateInterface<m_IDirect3DVolumeTexture9>(*ppVolumeTexture);
 	}
 
 	return hr;
@@ -189,9 +191,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateStateBlock(THIS_ D3DSTATEBLOCKTYPE Type, IDi
 {
 	HRESULT hr = ProxyInterface->CreateStateBlock(Type, ppSB);
 
-	if (SUCCEEDED(hr) && ppSB)
+	if (SUCCEEDED(hr) && ppSB && WrapResources)
 	{
-		*ppSB = new m_IDirect3DStateBlock9(*ppSB, this);
+		*ppSB = ProxyAddressLookupTable->CreateInterface<m_IDirect3DStateBlock9>(*ppSB);
 	}
 
 	return hr;
@@ -201,7 +203,7 @@ HRESULT m_IDirect3DDevice9Ex::EndStateBlock(THIS_ IDirect3DStateBlock9** ppSB)
 {
 	HRESULT hr = ProxyInterface->EndStateBlock(ppSB);
 
-	if (SUCCEEDED(hr) && ppSB)
+	if (SUCCEEDED(hr) && ppSB && WrapResources)
 	{
 		*ppSB = ProxyAddressLookupTable->FindAddress<m_IDirect3DStateBlock9>(*ppSB);
 	}
@@ -228,7 +230,7 @@ HRESULT m_IDirect3DDevice9Ex::GetRenderTarget(THIS_ DWORD RenderTargetIndex, IDi
 {
 	HRESULT hr = ProxyInterface->GetRenderTarget(RenderTargetIndex, ppRenderTarget);
 
-	if (SUCCEEDED(hr) && ppRenderTarget)
+	if (SUCCEEDED(hr) && ppRenderTarget && WrapResources)
 	{
 		*ppRenderTarget = ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface9>(*ppRenderTarget);
 	}
@@ -253,7 +255,7 @@ HRESULT m_IDirect3DDevice9Ex::SetRenderState(D3DRENDERSTATETYPE State, DWORD Val
 
 HRESULT m_IDirect3DDevice9Ex::SetRenderTarget(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
 {
-	if (pRenderTarget)
+	if (pRenderTarget && WrapResources)
 	{
 		pRenderTarget = static_cast<m_IDirect3DSurface9 *>(pRenderTarget)->GetProxyInterface();
 	}
@@ -295,7 +297,7 @@ HRESULT m_IDirect3DDevice9Ex::GetIndices(THIS_ IDirect3DIndexBuffer9** ppIndexDa
 {
 	HRESULT hr = ProxyInterface->GetIndices(ppIndexData);
 
-	if (SUCCEEDED(hr) && ppIndexData)
+	if (SUCCEEDED(hr) && ppIndexData && WrapResources)
 	{
 		*ppIndexData = ProxyAddressLookupTable->FindAddress<m_IDirect3DIndexBuffer9>(*ppIndexData);
 	}
@@ -305,7 +307,7 @@ HRESULT m_IDirect3DDevice9Ex::GetIndices(THIS_ IDirect3DIndexBuffer9** ppIndexDa
 
 HRESULT m_IDirect3DDevice9Ex::SetIndices(THIS_ IDirect3DIndexBuffer9* pIndexData)
 {
-	if (pIndexData)
+	if (pIndexData && WrapResources)
 	{
 		pIndexData = static_cast<m_IDirect3DIndexBuffer9 *>(pIndexData)->GetProxyInterface();
 	}
@@ -384,12 +386,12 @@ HRESULT m_IDirect3DDevice9Ex::MultiplyTransform(D3DTRANSFORMSTATETYPE State, CON
 
 HRESULT m_IDirect3DDevice9Ex::ProcessVertices(THIS_ UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags)
 {
-	if (pDestBuffer)
+	if (pDestBuffer && WrapResources)
 	{
 		pDestBuffer = static_cast<m_IDirect3DVertexBuffer9 *>(pDestBuffer)->GetProxyInterface();
 	}
 
-	if (pVertexDecl)
+	if (pVertexDecl && WrapResources)
 	{
 		pVertexDecl = static_cast<m_IDirect3DVertexDeclaration9 *>(pVertexDecl)->GetProxyInterface();
 	}
@@ -426,9 +428,9 @@ HRESULT m_IDirect3DDevice9Ex::CreatePixelShader(THIS_ CONST DWORD* pFunction, ID
 {
 	HRESULT hr = ProxyInterface->CreatePixelShader(pFunction, ppShader);
 
-	if (SUCCEEDED(hr) && ppShader)
+	if (SUCCEEDED(hr) && ppShader && WrapResources)
 	{
-		*ppShader = new m_IDirect3DPixelShader9(*ppShader, this);
+		*ppShader = ProxyAddressLookupTable->CreateInterface<m_IDirect3DPixelShader9>(*ppShader);
 	}
 
 	return hr;
@@ -438,7 +440,7 @@ HRESULT m_IDirect3DDevice9Ex::GetPixelShader(THIS_ IDirect3DPixelShader9** ppSha
 {
 	HRESULT hr = ProxyInterface->GetPixelShader(ppShader);
 
-	if (SUCCEEDED(hr) && ppShader)
+	if (SUCCEEDED(hr) && ppShader && WrapResources)
 	{
 		*ppShader = ProxyAddressLookupTable->FindAddress<m_IDirect3DPixelShader9>(*ppShader);
 	}
@@ -448,7 +450,7 @@ HRESULT m_IDirect3DDevice9Ex::GetPixelShader(THIS_ IDirect3DPixelShader9** ppSha
 
 HRESULT m_IDirect3DDevice9Ex::SetPixelShader(THIS_ IDirect3DPixelShader9* pShader)
 {
-	if (pShader)
+	if (pShader && WrapResources)
 	{
 		pShader = static_cast<m_IDirect3DPixelShader9 *>(pShader)->GetProxyInterface();
 	}
@@ -490,7 +492,7 @@ HRESULT m_IDirect3DDevice9Ex::GetStreamSource(THIS_ UINT StreamNumber, IDirect3D
 {
 	HRESULT hr = ProxyInterface->GetStreamSource(StreamNumber, ppStreamData, OffsetInBytes, pStride);
 
-	if (SUCCEEDED(hr) && ppStreamData)
+	if (SUCCEEDED(hr) && ppStreamData && WrapResources)
 	{
 		*ppStreamData = ProxyAddressLookupTable->FindAddress<m_IDirect3DVertexBuffer9>(*ppStreamData);
 	}
@@ -500,7 +502,7 @@ HRESULT m_IDirect3DDevice9Ex::GetStreamSource(THIS_ UINT StreamNumber, IDirect3D
 
 HRESULT m_IDirect3DDevice9Ex::SetStreamSource(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride)
 {
-	if (pStreamData)
+	if (pStreamData && WrapResources)
 	{
 		pStreamData = static_cast<m_IDirect3DVertexBuffer9 *>(pStreamData)->GetProxyInterface();
 	}
@@ -512,7 +514,7 @@ HRESULT m_IDirect3DDevice9Ex::GetBackBuffer(THIS_ UINT iSwapChain, UINT iBackBuf
 {
 	HRESULT hr = ProxyInterface->GetBackBuffer(iSwapChain, iBackBuffer, Type, ppBackBuffer);
 
-	if (SUCCEEDED(hr) && ppBackBuffer)
+	if (SUCCEEDED(hr) && ppBackBuffer && WrapResources)
 	{
 		*ppBackBuffer = ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface9>(*ppBackBuffer);
 	}
@@ -524,7 +526,7 @@ HRESULT m_IDirect3DDevice9Ex::GetDepthStencilSurface(IDirect3DSurface9 **ppZSten
 {
 	HRESULT hr = ProxyInterface->GetDepthStencilSurface(ppZStencilSurface);
 
-	if (SUCCEEDED(hr) && ppZStencilSurface)
+	if (SUCCEEDED(hr) && ppZStencilSurface && WrapResources)
 	{
 		*ppZStencilSurface = ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface9>(*ppZStencilSurface);
 	}
@@ -536,8 +538,24 @@ HRESULT m_IDirect3DDevice9Ex::GetTexture(DWORD Stage, IDirect3DBaseTexture9 **pp
 {
 	HRESULT hr = ProxyInterface->GetTexture(Stage, ppTexture);
 
-	if (SUCCEEDED(hr) && ppTexture && *ppTexture)
+	if (SUCCEEDED(hr) && ppTexture && *ppTexture && WrapResources)
 	{
+		// The bound texture is almost always one we wrapped ourselves, so look in the caches before asking the runtime
+		IDirect3DBaseTexture9 *pWrapper = ProxyAddressLookupTable->FindWrapper<m_IDirect3DTexture9>(*ppTexture);
+		if (!pWrapper)
+		{
+			pWrapper = ProxyAddressLookupTable->FindWrapper<m_IDirect3DCubeTexture9>(*ppTexture);
+		}
+		if (!pWrapper)
+		{
+			pWrapper = ProxyAddressLookupTable->FindWrapper<m_IDirect3DVolumeTexture9>(*ppTexture);
+		}
+		if (pWrapper)
+		{
+			*ppTexture = pWrapper;
+			return hr;
+		}
+
 		switch ((*ppTexture)->GetType())
 		{
 		case D3DRTYPE_TEXTURE:
@@ -564,18 +582,16 @@ HRESULT m_IDirect3DDevice9Ex::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGES
 
 HRESULT m_IDirect3DDevice9Ex::SetTexture(DWORD Stage, IDirect3DBaseTexture9 *pTexture)
 {
-	if (pTexture)
+	if (pTexture && WrapResources)
 	{
-		switch (pTexture->GetType())
+		AddressLookupTableObject *Object = AddressLookupTableObject::FromInterface(pTexture);
+
+		switch (Object->GetResourceType())
 		{
 		case D3DRTYPE_TEXTURE:
-			pTexture = static_cast<m_IDirect3DTexture9 *>(pTexture)->GetProxyInterface();
-			break;
 		case D3DRTYPE_VOLUMETEXTURE:
-			pTexture = static_cast<m_IDirect3DVolumeTexture9 *>(pTexture)->GetProxyInterface();
-			break;
 		case D3DRTYPE_CUBETEXTURE:
-			pTexture = static_cast<m_IDirect3DCubeTexture9 *>(pTexture)->GetProxyInterface();
+			pTexture = static_cast<IDirect3DBaseTexture9 *>(Object->GetProxyAddress());
 			break;
 		default:
 			return D3DERR_INVALIDCALL;
@@ -592,35 +608,31 @@ HRESULT m_IDirect3DDevice9Ex::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGES
 
 HRESULT m_IDirect3DDevice9Ex::UpdateTexture(IDirect3DBaseTexture9 *pSourceTexture, IDirect3DBaseTexture9 *pDestinationTexture)
 {
-	if (pSourceTexture)
+	if (pSourceTexture && WrapResources)
 	{
-		switch (pSourceTexture->GetType())
+		AddressLookupTableObject *SourceObject = AddressLookupTableObject::FromInterface(pSourceTexture);
+
+		switch (SourceObject->GetResourceType())
 		{
 		case D3DRTYPE_TEXTURE:
-			pSourceTexture = static_cast<m_IDirect3DTexture9 *>(pSourceTexture)->GetProxyInterface();
-			break;
 		case D3DRTYPE_VOLUMETEXTURE:
-			pSourceTexture = static_cast<m_IDirect3DVolumeTexture9 *>(pSourceTexture)->GetProxyInterface();
-			break;
 		case D3DRTYPE_CUBETEXTURE:
-			pSourceTexture = static_cast<m_IDirect3DCubeTexture9 *>(pSourceTexture)->GetProxyInterface();
+			pSourceTexture = static_cast<IDirect3DBaseTexture9 *>(SourceObject->GetProxyAddress());
 			break;
 		default:
 			return D3DERR_INVALIDCALL;
 		}
 	}
-	if (pDestinationTexture)
+	if (pDestinationTexture && WrapResources)
 	{
-		switch (pDestinationTexture->GetType())
+		AddressLookupTableObject *DestinationObject = AddressLookupTableObject::FromInterface(pDestinationTexture);
+
+		switch (DestinationObject->GetResourceType())
 		{
 		case D3DRTYPE_TEXTURE:
-			pDestinationTexture = static_cast<m_IDirect3DTexture9 *>(pDestinationTexture)->GetProxyInterface();
-			break;
 		case D3DRTYPE_VOLUMETEXTURE:
-			pDestinationTexture = static_cast<m_IDirect3DVolumeTexture9 *>(pDestinationTexture)->GetProxyInterface();
-			break;
 		case D3DRTYPE_CUBETEXTURE:
-			pDestinationTexture = static_cast<m_IDirect3DCubeTexture9 *>(pDestinationTexture)->GetProxyInterface();
+			pDestinationTexture = static_cast<IDirect3DBaseTexture9 *>(DestinationObject->GetProxyAddress());
 			break;
 		default:
 			return D3DERR_INVALIDCALL;
@@ -664,9 +676,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateVertexShader(THIS_ CONST DWORD* pFunction, I
 {
 	HRESULT hr = ProxyInterface->CreateVertexShader(pFunction, ppShader);
 
-	if (SUCCEEDED(hr) && ppShader)
+	if (SUCCEEDED(hr) && ppShader && WrapResources)
 	{
-		*ppShader = new m_IDirect3DVertexShader9(*ppShader, this);
+		*ppShader = ProxyAddressLookupTable->CreateInterface<m_IDirect3DVertexShader9>(*ppShader);
 	}
 
 	return hr;
@@ -676,7 +688,7 @@ HRESULT m_IDirect3DDevice9Ex::GetVertexShader(THIS_ IDirect3DVertexShader9** ppS
 {
 	HRESULT hr = ProxyInterface->GetVertexShader(ppShader);
 
-	if (SUCCEEDED(hr) && ppShader)
+	if (SUCCEEDED(hr) && ppShader && WrapResources)
 	{
 		*ppShader = ProxyAddressLookupTable->FindAddress<m_IDirect3DVertexShader9>(*ppShader);
 	}
@@ -686,7 +698,7 @@ HRESULT m_IDirect3DDevice9Ex::GetVertexShader(THIS_ IDirect3DVertexShader9** ppS
 
 HRESULT m_IDirect3DDevice9Ex::SetVertexShader(THIS_ IDirect3DVertexShader9* pShader)
 {
-	if (pShader)
+	if (pShader && WrapResources)
 	{
 		pShader = static_cast<m_IDirect3DVertexShader9 *>(pShader)->GetProxyInterface();
 	}
@@ -698,9 +710,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateQuery(THIS_ D3DQUERYTYPE Type, IDirect3DQuer
 {
 	HRESULT hr = ProxyInterface->CreateQuery(Type, ppQuery);
 
-	if (SUCCEEDED(hr) && ppQuery)
+	if (SUCCEEDED(hr) && ppQuery && WrapResources)
 	{
-		*ppQuery = new m_IDirect3DQuery9(*ppQuery, this);
+		*ppQuery = ProxyAddressLookupTable->CreateInterface<m_IDirect3DQuery9>(*ppQuery);
 	}
 
 	return hr;
@@ -790,9 +802,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateVertexDeclaration(THIS_ CONST D3DVERTEXELEME
 {
 	HRESULT hr = ProxyInterface->CreateVertexDeclaration(pVertexElements, ppDecl);
 
-	if (SUCCEEDED(hr) && ppDecl)
+	if (SUCCEEDED(hr) && ppDecl && WrapResources)
 	{
-		*ppDecl = new m_IDirect3DVertexDeclaration9(*ppDecl, this);
+		*ppDecl = ProxyAddressLookupTable->CreateInterface<m_IDirect3DVertexDeclaration9>(*ppDecl);
 	}
 
 	return hr;
@@ -800,7 +812,7 @@ HRESULT m_IDirect3DDevice9Ex::CreateVertexDeclaration(THIS_ CONST D3DVERTEXELEME
 
 HRESULT m_IDirect3DDevice9Ex::SetVertexDeclaration(THIS_ IDirect3DVertexDeclaration9* pDecl)
 {
-	if (pDecl)
+	if (pDecl && WrapResources)
 	{
 		pDecl = static_cast<m_IDirect3DVertexDeclaration9 *>(pDecl)->GetProxyInterface();
 	}
@@ -812,7 +824,7 @@ HRESULT m_IDirect3DDevice9Ex::GetVertexDeclaration(THIS_ IDirect3DVertexDeclarat
 {
 	HRESULT hr = ProxyInterface->GetVertexDeclaration(ppDecl);
 
-	if (SUCCEEDED(hr) && ppDecl)
+	if (SUCCEEDED(hr) && ppDecl && WrapResources)
 	{
 		*ppDecl = ProxyAddressLookupTable->FindAddress<m_IDirect3DVertexDeclaration9>(*ppDecl);
 	}
@@ -872,7 +884,7 @@ HRESULT m_IDirect3DDevice9Ex::SetSamplerState(THIS_ DWORD Sampler, D3DSAMPLERSTA
 
 HRESULT m_IDirect3DDevice9Ex::SetDepthStencilSurface(THIS_ IDirect3DSurface9* pNewZStencil)
 {
-	if (pNewZStencil)
+	if (pNewZStencil && WrapResources)
 	{
 		pNewZStencil = static_cast<m_IDirect3DSurface9 *>(pNewZStencil)->GetProxyInterface();
 	}
@@ -884,9 +896,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateOffscreenPlainSurface(THIS_ UINT Width, UINT
 {
 	HRESULT hr = ProxyInterface->CreateOffscreenPlainSurface(Width, Height, Format, Pool, ppSurface, pSharedHandle);
 
-	if (SUCCEEDED(hr) && ppSurface)
+	if (SUCCEEDED(hr) && ppSurface && WrapResources)
 	{
-		*ppSurface = new m_IDirect3DSurface9(*ppSurface, this);
+		*ppSurface = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSurface9>(*ppSurface);
 	}
 
 	return hr;
@@ -894,7 +906,7 @@ HRESULT m_IDirect3DDevice9Ex::CreateOffscreenPlainSurface(THIS_ UINT Width, UINT
 
 HRESULT m_IDirect3DDevice9Ex::ColorFill(THIS_ IDirect3DSurface9* pSurface, CONST RECT* pRect, D3DCOLOR color)
 {
-	if (pSurface)
+	if (pSurface && WrapResources)
 	{
 		pSurface = static_cast<m_IDirect3DSurface9 *>(pSurface)->GetProxyInterface();
 	}
@@ -904,12 +916,12 @@ HRESULT m_IDirect3DDevice9Ex::ColorFill(THIS_ IDirect3DSurface9* pSurface, CONST
 
 HRESULT m_IDirect3DDevice9Ex::StretchRect(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter)
 {
-	if (pSourceSurface)
+	if (pSourceSurface && WrapResources)
 	{
 		pSourceSurface = static_cast<m_IDirect3DSurface9 *>(pSourceSurface)->GetProxyInterface();
 	}
 
-	if (pDestSurface)
+	if (pDestSurface && WrapResources)
 	{
 		pDestSurface = static_cast<m_IDirect3DSurface9 *>(pDestSurface)->GetProxyInterface();
 	}
@@ -919,7 +931,7 @@ HRESULT m_IDirect3DDevice9Ex::StretchRect(THIS_ IDirect3DSurface9* pSourceSurfac
 
 HRESULT m_IDirect3DDevice9Ex::GetFrontBufferData(THIS_ UINT iSwapChain, IDirect3DSurface9* pDestSurface)
 {
-	if (pDestSurface)
+	if (pDestSurface && WrapResources)
 	{
 		pDestSurface = static_cast<m_IDirect3DSurface9 *>(pDestSurface)->GetProxyInterface();
 	}
@@ -929,12 +941,12 @@ HRESULT m_IDirect3DDevice9Ex::GetFrontBufferData(THIS_ UINT iSwapChain, IDirect3
 
 HRESULT m_IDirect3DDevice9Ex::GetRenderTargetData(THIS_ IDirect3DSurface9* pRenderTarget, IDirect3DSurface9* pDestSurface)
 {
-	if (pRenderTarget)
+	if (pRenderTarget && WrapResources)
 	{
 		pRenderTarget = static_cast<m_IDirect3DSurface9 *>(pRenderTarget)->GetProxyInterface();
 	}
 
-	if (pDestSurface)
+	if (pDestSurface && WrapResources)
 	{
 		pDestSurface = static_cast<m_IDirect3DSurface9 *>(pDestSurface)->GetProxyInterface();
 	}
@@ -944,12 +956,12 @@ HRESULT m_IDirect3DDevice9Ex::GetRenderTargetData(THIS_ IDirect3DSurface9* pRend
 
 HRESULT m_IDirect3DDevice9Ex::UpdateSurface(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestinationSurface, CONST POINT* pDestPoint)
 {
-	if (pSourceSurface)
+	if (pSourceSurface && WrapResources)
 	{
 		pSourceSurface = static_cast<m_IDirect3DSurface9 *>(pSourceSurface)->GetProxyInterface();
 	}
 
-	if (pDestinationSurface)
+	if (pDestinationSurface && WrapResources)
 	{
 		pDestinationSurface = static_cast<m_IDirect3DSurface9 *>(pDestinationSurface)->GetProxyInterface();
 	}
@@ -981,22 +993,22 @@ HRESULT m_IDirect3DDevice9Ex::SetConvolutionMonoKernel(THIS_ UINT width, UINT he
 
 HRESULT m_IDirect3DDevice9Ex::ComposeRects(THIS_ IDirect3DSurface9* pSrc, IDirect3DSurface9* pDst, IDirect3DVertexBuffer9* pSrcRectDescs, UINT NumRects, IDirect3DVertexBuffer9* pDstRectDescs, D3DCOMPOSERECTSOP Operation, int Xoffset, int Yoffset)
 {
-	if (pSrc)
+	if (pSrc && WrapResources)
 	{
 		pSrc = static_cast<m_IDirect3DSurface9 *>(pSrc)->GetProxyInterface();
 	}
 
-	if (pDst)
+	if (pDst && WrapResources)
 	{
 		pDst = static_cast<m_IDirect3DSurface9 *>(pDst)->GetProxyInterface();
 	}
 
-	if (pSrcRectDescs)
+	if (pSrcRectDescs && WrapResources)
 	{
 		pSrcRectDescs = static_cast<m_IDirect3DVertexBuffer9 *>(pSrcRectDescs)->GetProxyInterface();
 	}
 
-	if (pDstRectDescs)
+	if (pDstRectDescs && WrapResources)
 	{
 		pDstRectDescs = static_cast<m_IDirect3DVertexBuffer9 *>(pDstRectDescs)->GetProxyInterface();
 	}
@@ -1026,34 +1038,23 @@ HRESULT m_IDirect3DDevice9Ex::WaitForVBlank(THIS_ UINT iSwapChain)
 
 HRESULT m_IDirect3DDevice9Ex::CheckResourceResidency(THIS_ IDirect3DResource9** pResourceArray, UINT32 NumResources)
 {
-	if (pResourceArray)
+	if (pResourceArray && WrapResources)
 	{
 		for (UINT32 i = 0; i < NumResources; i++)
 		{
 			if (pResourceArray[i])
 			{
-				switch (pResourceArray[i]->GetType())
+				AddressLookupTableObject *Object = AddressLookupTableObject::FromInterface(pResourceArray[i]);
+
+				switch (Object->GetResourceType())
 				{
 				case D3DRTYPE_SURFACE:
-					pResourceArray[i] = static_cast<m_IDirect3DSurface9 *>(pResourceArray[i])->GetProxyInterface();
-					break;
-				case D3DRTYPE_VOLUME:
-					pResourceArray[i] = (IDirect3DResource9*)reinterpret_cast<m_IDirect3DVolume9 *>(pResourceArray[i])->GetProxyInterface();
-					break;
 				case D3DRTYPE_TEXTURE:
-					pResourceArray[i] = static_cast<m_IDirect3DTexture9 *>(pResourceArray[i])->GetProxyInterface();
-					break;
 				case D3DRTYPE_VOLUMETEXTURE:
-					pResourceArray[i] = static_cast<m_IDirect3DVolumeTexture9 *>(pResourceArray[i])->GetProxyInterface();
-					break;
 				case D3DRTYPE_CUBETEXTURE:
-					pResourceArray[i] = static_cast<m_IDirect3DCubeTexture9 *>(pResourceArray[i])->GetProxyInterface();
-					break;
 				case D3DRTYPE_VERTEXBUFFER:
-					pResourceArray[i] = static_cast<m_IDirect3DVertexBuffer9 *>(pResourceArray[i])->GetProxyInterface();
-					break;
 				case D3DRTYPE_INDEXBUFFER:
-					pResourceArray[i] = static_cast<m_IDirect3DIndexBuffer9 *>(pResourceArray[i])->GetProxyInterface();
+					pResourceArray[i] = static_cast<IDirect3DResource9 *>(Object->GetProxyAddress());
 					break;
 				default:
 					return D3DERR_INVALIDCALL;
@@ -1084,9 +1085,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateRenderTargetEx(THIS_ UINT Width, UINT Height
 {
 	HRESULT hr = ProxyInterface->CreateRenderTargetEx(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle, Usage);
 
-	if (SUCCEEDED(hr) && ppSurface)
+	if (SUCCEEDED(hr) && ppSurface && WrapResources)
 	{
-		*ppSurface = new m_IDirect3DSurface9(*ppSurface, this);
+		*ppSurface = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSurface9>(*ppSurface);
 	}
 
 	return hr;
@@ -1096,9 +1097,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateOffscreenPlainSurfaceEx(THIS_ UINT Width, UI
 {
 	HRESULT hr = ProxyInterface->CreateOffscreenPlainSurfaceEx(Width, Height, Format, Pool, ppSurface, pSharedHandle, Usage);
 
-	if (SUCCEEDED(hr) && ppSurface)
+	if (SUCCEEDED(hr) && ppSurface && WrapResources)
 	{
-		*ppSurface = new m_IDirect3DSurface9(*ppSurface, this);
+		*ppSurface = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSurface9>(*ppSurface);
 	}
 
 	return hr;
@@ -1108,9 +1109,9 @@ HRESULT m_IDirect3DDevice9Ex::CreateDepthStencilSurfaceEx(THIS_ UINT Width, UINT
 {
 	HRESULT hr = ProxyInterface->CreateDepthStencilSurfaceEx(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle, Usage);
 
-	if (SUCCEEDED(hr) && ppSurface)
+	if (SUCCEEDED(hr) && ppSurface && WrapResources)
 	{
-		*ppSurface = new m_IDirect3DSurface9(*ppSurface, this);
+		*ppSurface = ProxyAddressLookupTable->CreateInterface<m_IDirect3DSurface9>(*ppSurface);
 	}
 
 	return hr;
@@ -6,15 +6,21 @@ private:
 	LPDIRECT3DDEVICE9EX ProxyInterface;
 	m_IDirect3D9Ex* m_pD3DEx;
 	REFIID WrapperID;
+	const bool WrapResources;
+	volatile LONG AppRefCount = 1;		// References held through the wrapper; the proxy's count also includes the wrapper's own resources
 
 public:
-	m_IDirect3DDevice9Ex(LPDIRECT3DDEVICE9EX pDevice, m_IDirect3D9Ex* pD3D, REFIID DeviceID = IID_IUnknown) : ProxyInterface(pDevice), m_pD3DEx(pD3D), WrapperID(DeviceID)
+	m_IDirect3DDevice9Ex(LPDIRECT3DDEVICE9EX pDevice, m_IDirect3D9Ex* pD3D, REFIID DeviceID = IID_IUnknown, bool bWrapResources = true) : ProxyInterface(pDevice), m_pD3DEx(pD3D), WrapperID(DeviceID), WrapResources(bWrapResources)
 	{
 		InitDirect3DDevice();
 	}
 	void InitDirect3DDevice()
 	{
-		ProxyAddressLookupTable = new AddressLookupTable<m_IDirect3DDevice9Ex>(this);
+		// Resources may be created and released from several threads only on a multithreaded device
+		D3DDEVICE_CREATION_PARAMETERS Parameters = {};
+		bool Multithreaded = SUCCEEDED(ProxyInterface->GetCreationParameters(&Parameters)) && (Parameters.BehaviorFlags & D3DCREATE_MULTITHREADED);
+
+		ProxyAddressLookupTable = new AddressLookupTable<m_IDirect3DDevice9Ex>(this, Multithreaded);
 	}
 	~m_IDirect3DDevice9Ex()
 	{
@@ -22,6 +28,9 @@ public:
 	}
 
 	LPDIRECT3DDEVICE9EX GetProxyInterface() { return ProxyInterface; }
+	// When false, resources are handed out as the runtime's own interfaces and only the device and swap chains are wrapped.
+	// Their GetDevice and GetContainer then lead to the runtime's device and swap chains, past the wrappers.
+	bool IsWrappingResources() const { return WrapResources; }
 	AddressLookupTable<m_IDirect3DDevice9Ex> *ProxyAddressLookupTable;
 
 	/*** IUnknown methods ***/
@@ -44,7 +44,7 @@ ULONG m_IDirect3DIndexBuffer9::AddRef(THIS)
 
 ULONG m_IDirect3DIndexBuffer9::Release(THIS)
 {
-	return ProxyInterface->Release();
+	return m_pDeviceEx->ProxyAddressLookupTable->ReleaseInterface(this, ProxyInterface);
 }
 
 HRESULT m_IDirect3DIndexBuffer9::GetDevice(THIS_ IDirect3DDevice9** ppDevice)
@@ -93,7 +93,7 @@ void m_IDirect3DIndexBuffer9::PreLoad(THIS)
 
 D3DRESOURCETYPE m_IDirect3DIndexBuffer9::GetType(THIS)
 {
-	return ProxyInterface->GetType();
+	return GetResourceType();
 }
 
 HRESULT m_IDirect3DIndexBuffer9::Lock(THIS_ UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags)
@@ -7,10 +7,7 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
 
 public:
-	m_IDirect3DIndexBuffer9(LPDIRECT3DINDEXBUFFER9 pBuffer9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pBuffer9), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DIndexBuffer9(LPDIRECT3DINDEXBUFFER9 pBuffer9, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_INDEXBUFFER), ProxyInterface(pBuffer9), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DIndexBuffer9() {}
 
 	LPDIRECT3DINDEXBUFFER9 GetProxyInterface() { return ProxyInterface; }
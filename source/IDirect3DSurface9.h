@@ -7,10 +7,7 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
 
 public:
-	m_IDirect3DSurface9(LPDIRECT3DSURFACE9 pSurface9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pSurface9), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DSurface9(LPDIRECT3DSURFACE9 pSurface9, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_SURFACE), ProxyInterface(pSurface9), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DSurface9() {}
 
 	LPDIRECT3DSURFACE9 GetProxyInterface() { return ProxyInterface; }
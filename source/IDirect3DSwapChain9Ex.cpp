@@ -44,36 +44,70 @@ ULONG m_IDirect3DSwapChain9Ex::AddRef(THIS)
 
 ULONG m_IDirect3DSwapChain9Ex::Release(THIS)
 {
-	return ProxyInterface->Release();
+	return m_pDeviceEx->ProxyAddressLookupTable->ReleaseInterface(this, ProxyInterface);
 }
 
-HRESULT m_IDirect3DSwapChain9Ex::Present(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
-{
-	return ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
-}
+//HRESULT m_IDirect3DSwapChain9Ex::Present(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
+//{
+//	return ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
+//}
 
 HRESULT m_IDirect3DSwapChain9Ex::GetFrontBufferData(THIS_ IDirect3DSurface9* pDestSurface)
 {
-	if (pDestSurface)
+	if (pDestSurface && m_pDeviceEx->IsWrappingResources())
 	{
 		pDestSurface = static_cast<m_IDirect3DSurface9 *>(pDestSurface)->GetProxyInterface();
 	}
 
-	return GetFrontBufferData(pDestSurface);
+	return ProxyInterface->GetFrontBufferData(pDestSurface);
 }
 
 HRESULT m_IDirect3DSwapChain9Ex::GetBackBuffer(THIS_ UINT BackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer)
 {
+	// Only mono back buffers exist in D3D9, other types are left for the runtime to reject
+	const bool Cacheable = Type == D3DBACKBUFFER_TYPE_MONO && BackBuffer < D3DPRESENT_BACK_BUFFERS_MAX_EX;
+
+	// Back buffers are released on their own, possibly on another thread, so the slot is read under the table's lock
+	if (Cacheable && ppBackBuffer)
+	{
+		if (m_IDirect3DSurface9 *pSurface = m_pDeviceEx->ProxyAddressLookupTable->AddRefCached(BackBuffers[BackBuffer]))
+		{
+			*ppBackBuffer = pSurface;
+
+			return D3D_OK;
+		}
+	}
+
 	HRESULT hr = ProxyInterface->GetBackBuffer(BackBuffer, Type, ppBackBuffer);
 
-	if (SUCCEEDED(hr) && ppBackBuffer)
+	if (SUCCEEDED(hr) && ppBackBuffer && m_pDeviceEx->IsWrappingResources())
 	{
-		*ppBackBuffer = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface9>(*ppBackBuffer);
+		// The cache holds no reference: the back buffer counts its own, and ForgetChild clears the slot
+		// once the application releases it and its wrapper is destroyed
+		m_IDirect3DSurface9 *pSurface = m_pDeviceEx->ProxyAddressLookupTable->FindChild<m_IDirect3DSurface9>(*ppBackBuffer, this);
+
+		if (Cacheable)
+		{
+			BackBuffers[BackBuffer] = pSurface;
+		}
+
+		*ppBackBuffer = pSurface;
 	}
 
 	return hr;
 }
 
+void m_IDirect3DSwapChain9Ex::ForgetChild(AddressLookupTableObject *Child)
+{
+	for (m_IDirect3DSurface9 *&pSurface : BackBuffers)
+	{
+		if (pSurface && static_cast<AddressLookupTableObject *>(pSurface) == Child)
+		{
+			pSurface = nullptr;
+		}
+	}
+}
+
 HRESULT m_IDirect3DSwapChain9Ex::GetRasterStatus(THIS_ D3DRASTER_STATUS* pRasterStatus)
 {
 	return ProxyInterface->GetRasterStatus(pRasterStatus);
@@ -6,12 +6,13 @@ private:
 	LPDIRECT3DSWAPCHAIN9EX ProxyInterface;
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
 	REFIID WrapperID;
+	m_IDirect3DSurface9* BackBuffers[D3DPRESENT_BACK_BUFFERS_MAX_EX] = {};
+
+protected:
+	void ForgetChild(AddressLookupTableObject *Child) override;
 
 public:
-	m_IDirect3DSwapChain9Ex(LPDIRECT3DSWAPCHAIN9EX pSwapChain9, m_IDirect3DDevice9Ex* pDevice, REFIID DeviceID = IID_IDirect3DSwapChain9) : ProxyInterface(pSwapChain9), m_pDeviceEx(pDevice), WrapperID(DeviceID)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DSwapChain9Ex(LPDIRECT3DSWAPCHAIN9EX pSwapChain9, m_IDirect3DDevice9Ex* pDevice, REFIID DeviceID = IID_IDirect3DSwapChain9) : ProxyInterface(pSwapChain9), m_pDeviceEx(pDevice), WrapperID(DeviceID) { }
 	~m_IDirect3DSwapChain9Ex() {}
 
 	LPDIRECT3DSWAPCHAIN9EX GetProxyInterface() { return ProxyInterface; }
@@ -44,7 +44,7 @@ ULONG m_IDirect3DTexture9::AddRef(THIS)
 
 ULONG m_IDirect3DTexture9::Release(THIS)
 {
-	return ProxyInterface->Release();
+	return m_pDeviceEx->ProxyAddressLookupTable->ReleaseInterface(this, ProxyInterface);
 }
 
 HRESULT m_IDirect3DTexture9::GetDevice(THIS_ IDirect3DDevice9** ppDevice)
@@ -93,7 +93,7 @@ void m_IDirect3DTexture9::PreLoad(THIS)
 
 D3DRESOURCETYPE m_IDirect3DTexture9::GetType(THIS)
 {
-	return ProxyInterface->GetType();
+	return GetResourceType();
 }
 
 DWORD m_IDirect3DTexture9::SetLOD(THIS_ DWORD LODNew)
@@ -133,16 +133,43 @@ HRESULT m_IDirect3DTexture9::GetLevelDesc(THIS_ UINT Level, D3DSURFACE_DESC *pDe
 
 HRESULT m_IDirect3DTexture9::GetSurfaceLevel(THIS_ UINT Level, IDirect3DSurface9** ppSurfaceLevel)
 {
+	if (Level < MaxCachedLevels && SurfaceLevels[Level] && ppSurfaceLevel)
+	{
+		SurfaceLevels[Level]->AddRef();
+
+		*ppSurfaceLevel = SurfaceLevels[Level];
+
+		return D3D_OK;
+	}
+
 	HRESULT hr = ProxyInterface->GetSurfaceLevel(Level, ppSurfaceLevel);
 
 	if (SUCCEEDED(hr) && ppSurfaceLevel)
 	{
-		*ppSurfaceLevel = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface9>(*ppSurfaceLevel);
+		m_IDirect3DSurface9 *pSurface = m_pDeviceEx->ProxyAddressLookupTable->FindChild<m_IDirect3DSurface9>(*ppSurfaceLevel, this);
+
+		if (Level < MaxCachedLevels)
+		{
+			SurfaceLevels[Level] = pSurface;
+		}
+
+		*ppSurfaceLevel = pSurface;
 	}
 
 	return hr;
 }
 
+void m_IDirect3DTexture9::ForgetChild(AddressLookupTableObject *Child)
+{
+	for (m_IDirect3DSurface9 *&pSurface : SurfaceLevels)
+	{
+		if (pSurface && static_cast<AddressLookupTableObject *>(pSurface) == Child)
+		{
+			pSurface = nullptr;
+		}
+	}
+}
+
 HRESULT m_IDirect3DTexture9::LockRect(THIS_ UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
 {
 	return ProxyInterface->LockRect(Level, pLockedRect, pRect, Flags);
@@ -5,12 +5,13 @@ class m_IDirect3DTexture9 : public IDirect3DTexture9, public AddressLookupTableO
 private:
 	LPDIRECT3DTEXTURE9 ProxyInterface;
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
+	m_IDirect3DSurface9* SurfaceLevels[MaxCachedLevels] = {};
+
+protected:
+	void ForgetChild(AddressLookupTableObject *Child) override;
 
 public:
-	m_IDirect3DTexture9(LPDIRECT3DTEXTURE9 pTexture9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pTexture9), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DTexture9(LPDIRECT3DTEXTURE9 pTexture9, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_TEXTURE), ProxyInterface(pTexture9), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DTexture9() {}
 
 	LPDIRECT3DTEXTURE9 GetProxyInterface() { return ProxyInterface; }
@@ -7,10 +7,7 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
 
 public:
-	m_IDirect3DVertexBuffer9(LPDIRECT3DVERTEXBUFFER9 pBuffer8, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pBuffer8), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DVertexBuffer9(LPDIRECT3DVERTEXBUFFER9 pBuffer8, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_VERTEXBUFFER), ProxyInterface(pBuffer8), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DVertexBuffer9() {}
 
 	LPDIRECT3DVERTEXBUFFER9 GetProxyInterface() { return ProxyInterface; }
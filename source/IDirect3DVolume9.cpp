@@ -44,7 +44,7 @@ ULONG m_IDirect3DVolume9::AddRef(THIS)
 
 ULONG m_IDirect3DVolume9::Release(THIS)
 {
-	return ProxyInterface->Release();
+	return m_pDeviceEx->ProxyAddressLookupTable->ReleaseInterface(this, ProxyInterface);
 }
 
 HRESULT m_IDirect3DVolume9::GetDevice(THIS_ IDirect3DDevice9** ppDevice)
@@ -7,10 +7,7 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
 
 public:
-	m_IDirect3DVolume9(LPDIRECT3DVOLUME9 pVolume8, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pVolume8), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DVolume9(LPDIRECT3DVOLUME9 pVolume8, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_VOLUME), ProxyInterface(pVolume8), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DVolume9() {}
 
 	LPDIRECT3DVOLUME9 GetProxyInterface() { return ProxyInterface; }
@@ -44,7 +44,7 @@ ULONG m_IDirect3DVolumeTexture9::AddRef(THIS)
 
 ULONG m_IDirect3DVolumeTexture9::Release(THIS)
 {
-	return ProxyInterface->Release();
+	return m_pDeviceEx->ProxyAddressLookupTable->ReleaseInterface(this, ProxyInterface);
 }
 
 HRESULT m_IDirect3DVolumeTexture9::GetDevice(THIS_ IDirect3DDevice9** ppDevice)
@@ -93,7 +93,7 @@ void m_IDirect3DVolumeTexture9::PreLoad(THIS)
 
 D3DRESOURCETYPE m_IDirect3DVolumeTexture9::GetType(THIS)
 {
-	return ProxyInterface->GetType();
+	return GetResourceType();
 }
 
 DWORD m_IDirect3DVolumeTexture9::SetLOD(THIS_ DWORD LODNew)
@@ -133,16 +133,43 @@ HRESULT m_IDirect3DVolumeTexture9::GetLevelDesc(THIS_ UINT Level, D3DVOLUME_DESC
 
 HRESULT m_IDirect3DVolumeTexture9::GetVolumeLevel(THIS_ UINT Level, IDirect3DVolume9** ppVolumeLevel)
 {
+	if (Level < MaxCachedLevels && VolumeLevels[Level] && ppVolumeLevel)
+	{
+		VolumeLevels[Level]->AddRef();
+
+		*ppVolumeLevel = VolumeLevels[Level];
+
+		return D3D_OK;
+	}
+
 	HRESULT hr = ProxyInterface->GetVolumeLevel(Level, ppVolumeLevel);
 
 	if (SUCCEEDED(hr) && ppVolumeLevel)
 	{
-		*ppVolumeLevel = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<m_IDirect3DVolume9>(*ppVolumeLevel);
+		m_IDirect3DVolume9 *pVolume = m_pDeviceEx->ProxyAddressLookupTable->FindChild<m_IDirect3DVolume9>(*ppVolumeLevel, this);
+
+		if (Level < MaxCachedLevels)
+		{
+			VolumeLevels[Level] = pVolume;
+		}
+
+		*ppVolumeLevel = pVolume;
 	}
 
 	return hr;
 }
 
+void m_IDirect3DVolumeTexture9::ForgetChild(AddressLookupTableObject *Child)
+{
+	for (m_IDirect3DVolume9 *&pVolume : VolumeLevels)
+	{
+		if (pVolume && static_cast<AddressLookupTableObject *>(pVolume) == Child)
+		{
+			pVolume = nullptr;
+		}
+	}
+}
+
 HRESULT m_IDirect3DVolumeTexture9::LockBox(THIS_ UINT Level, D3DLOCKED_BOX* pLockedVolume, CONST D3DBOX* pBox, DWORD Flags)
 {
 	return ProxyInterface->LockBox(Level, pLockedVolume, pBox, Flags);
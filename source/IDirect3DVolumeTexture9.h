@@ -5,12 +5,13 @@ class m_IDirect3DVolumeTexture9 : public IDirect3DVolumeTexture9, public Address
 private:
 	LPDIRECT3DVOLUMETEXTURE9 ProxyInterface;
 	m_IDirect3DDevice9Ex* m_pDeviceEx = nullptr;
+	m_IDirect3DVolume9* VolumeLevels[MaxCachedLevels] = {};
+
+protected:
+	void ForgetChild(AddressLookupTableObject *Child) override;
 
 public:
-	m_IDirect3DVolumeTexture9(LPDIRECT3DVOLUMETEXTURE9 pTexture8, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pTexture8), m_pDeviceEx(pDevice)
-	{
-		pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
-	}
+	m_IDirect3DVolumeTexture9(LPDIRECT3DVOLUMETEXTURE9 pTexture8, m_IDirect3DDevice9Ex* pDevice) : AddressLookupTableObject(D3DRTYPE_VOLUMETEXTURE), ProxyInterface(pTexture8), m_pDeviceEx(pDevice) { }
 	~m_IDirect3DVolumeTexture9() {}
 
 	LPDIRECT3DVOLUMETEXTURE9 GetProxyInterface() { return ProxyInterface; }
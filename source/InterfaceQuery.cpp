@@ -16,14 +16,11 @@
 
 #include "d3d9.h"
 
-void genericQueryInterface(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice9Ex* m_pDeviceEx)
+namespace
 {
-	if (!ppvObj || !*ppvObj || !m_pDeviceEx)
-	{
-		return;
-	}
+	typedef void(*QueryHandler)(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice9Ex* m_pDeviceEx);
 
-	if (riid == IID_IDirect3D9 || riid == IID_IDirect3D9Ex)
+	void QueryDirect3D(REFIID riid, LPVOID *, m_IDirect3DDevice9Ex* m_pDeviceEx)
 	{
 		IDirect3D9 *pD3D9 = nullptr;
 		if (SUCCEEDED(m_pDeviceEx->GetDirect3D(&pD3D9)) && pD3D9)
@@ -34,43 +31,116 @@ void genericQueryInterface(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice9Ex* m_
 				pD3D9wrapper->Release();
 			}
 			pD3D9->Release();
-			return;
 		}
 	}
 
-	if (riid == IID_IDirect3DDevice9 || riid == IID_IDirect3DDevice9Ex)
+	void QueryDevice(REFIID riid, LPVOID *, m_IDirect3DDevice9Ex* m_pDeviceEx)
 	{
 		IDirect3DDevice9 *pD3DDevice9 = nullptr;
 		if (SUCCEEDED(m_pDeviceEx->QueryInterface(riid, (LPVOID*)&pD3DDevice9)) && pD3DDevice9)
 		{
 			pD3DDevice9->Release();
 		}
-		return;
 	}
 
-	if (riid == IID_IDirect3DSwapChain9 || riid == IID_IDirect3DSwapChain9Ex)
+	void QuerySwapChain(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice9Ex* m_pDeviceEx)
 	{
 		*ppvObj = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<m_IDirect3DSwapChain9Ex>(*ppvObj, riid);
-		return;
 	}
 
-#define QUERYINTERFACE(x) \
-	if (riid == IID_ ## x) \
-		{ \
-			*ppvObj = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<m_ ## x>(*ppvObj); \
-			return; \
+	template <typename T>
+	void QueryResource(REFIID, LPVOID *ppvObj, m_IDirect3DDevice9Ex* m_pDeviceEx)
+	{
+		// Resources are not wrapped in passthrough mode, so hand back whatever the runtime returned
+		if (m_pDeviceEx->IsWrappingResources())
+		{
+			*ppvObj = m_pDeviceEx->ProxyAddressLookupTable->FindAddress<T>(*ppvObj);
 		}
+	}
 
-	QUERYINTERFACE(IDirect3DCubeTexture9);
-	QUERYINTERFACE(IDirect3DIndexBuffer9);
-	QUERYINTERFACE(IDirect3DPixelShader9);
-	QUERYINTERFACE(IDirect3DQuery9);
-	QUERYINTERFACE(IDirect3DStateBlock9);
-	QUERYINTERFACE(IDirect3DSurface9);
-	QUERYINTERFACE(IDirect3DTexture9);
-	QUERYINTERFACE(IDirect3DVertexBuffer9);
-	QUERYINTERFACE(IDirect3DVertexDeclaration9);
-	QUERYINTERFACE(IDirect3DVertexShader9);
-	QUERYINTERFACE(IDirect3DVolume9);
-	QUERYINTERFACE(IDirect3DVolumeTexture9);
+	struct QueryEntry
+	{
+		const IID *riid;
+		QueryHandler Handler;
+	};
+
+	constexpr QueryEntry QueryTable[] =
+	{
+		{ &IID_IDirect3D9, QueryDirect3D },
+		{ &IID_IDirect3D9Ex, QueryDirect3D },
+		{ &IID_IDirect3DDevice9, QueryDevice },
+		{ &IID_IDirect3DDevice9Ex, QueryDevice },
+		{ &IID_IDirect3DSwapChain9, QuerySwapChain },
+		{ &IID_IDirect3DSwapChain9Ex, QuerySwapChain },
+		{ &IID_IDirect3DCubeTexture9, QueryResource<m_IDirect3DCubeTexture9> },
+		{ &IID_IDirect3DIndexBuffer9, QueryResource<m_IDirect3DIndexBuffer9> },
+		{ &IID_IDirect3DPixelShader9, QueryResource<m_IDirect3DPixelShader9> },
+		{ &IID_IDirect3DQuery9, QueryResource<m_IDirect3DQuery9> },
+		{ &IID_IDirect3DStateBlock9, QueryResource<m_IDirect3DStateBlock9> },
+		{ &IID_IDirect3DSurface9, QueryResource<m_IDirect3DSurface9> },
+		{ &IID_IDirect3DTexture9, QueryResource<m_IDirect3DTexture9> },
+		{ &IID_IDirect3DVertexBuffer9, QueryResource<m_IDirect3DVertexBuffer9> },
+		{ &IID_IDirect3DVertexDeclaration9, QueryResource<m_IDirect3DVertexDeclaration9> },
+		{ &IID_IDirect3DVertexShader9, QueryResource<m_IDirect3DVertexShader9> },
+		{ &IID_IDirect3DVolume9, QueryResource<m_IDirect3DVolume9> },
+		{ &IID_IDirect3DVolumeTexture9, QueryResource<m_IDirect3DVolumeTexture9> },
+	};
+
+	// Open addressing index over QueryTable keyed by the first GUID field, which is already unique
+	// for the interfaces above. A query costs one multiply and usually a single GUID compare.
+	class QueryIndex
+	{
+	public:
+		QueryIndex()
+		{
+			for (const QueryEntry &Entry : QueryTable)
+			{
+				UINT i = Hash(Entry.riid->Data1);
+				while (Slots[i])
+				{
+					i = (i + 1) & (SlotCount - 1);
+				}
+				Slots[i] = &Entry;
+			}
+		}
+
+		QueryHandler Find(REFIID riid) const
+		{
+			for (UINT i = Hash(riid.Data1); Slots[i]; i = (i + 1) & (SlotCount - 1))
+			{
+				if (*Slots[i]->riid == riid)
+				{
+					return Slots[i]->Handler;
+				}
+			}
+			return nullptr;
+		}
+
+	private:
+		static constexpr UINT SlotBits = 6;
+		static constexpr UINT SlotCount = 1 << SlotBits;
+		static_assert(_countof(QueryTable) * 2 <= SlotCount, "QueryIndex is too small for QueryTable");
+
+		static UINT Hash(unsigned long Data1)
+		{
+			return (static_cast<UINT>(Data1) * 0x9E3779B1u) >> (32 - SlotBits);
+		}
+
+		const QueryEntry *Slots[SlotCount] = {};
+	};
+}
+
+void genericQueryInterface(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice9Ex* m_pDeviceEx)
+{
+	if (!ppvObj || !*ppvObj || !m_pDeviceEx)
+	{
+		return;
+	}
+
+	static const QueryIndex Index;
+
+	if (QueryHandler Handler = Index.Find(riid))
+	{
+		Handler(riid, ppvObj, m_pDeviceEx);
+	}
 }
@@ -0,0 +1,113 @@
+#pragma once
+
+// Control block shared with external tools as the named mapping Local\d3d9-wrapper-<pid>. To make a request, a
+// writer takes Sequence from an even value to the next odd one with InterlockedCompareExchange, retrying while it
+// is odd or was changed in between, changes the request fields, then increments it back to an even one. Hotkeys
+// make their requests the same way from the window thread, so a plain increment could interleave with theirs.
+// Between two frames the wrapper takes over a request whose even Sequence it has not applied yet, and reports what
+// is in effect in the Current fields. The option values mean the same as the d3d9.ini entries of the same names.
+struct LimiterControlBlock
+{
+	DWORD Magic;							// "D9LC"
+	DWORD Size;								// sizeof(LimiterControlBlock)
+	volatile LONG Sequence;
+	volatile LONG AppliedSequence;			// Written by the wrapper
+
+	double FPSLimit;
+	LONG FPSLimitMode;
+	LONG DisplayFPSCounter;
+
+	double CurrentFPSLimit;					// Written by the wrapper
+	LONG CurrentFPSLimitMode;
+	LONG CurrentDisplayFPSCounter;
+};
+
+class LimiterControl
+{
+public:
+	static constexpr DWORD Magic = 0x434C3944;		// "D9LC" in memory
+
+	struct Settings
+	{
+		double FPSLimit;
+		LONG FPSLimitMode;
+		LONG DisplayFPSCounter;
+	};
+
+	// Without a shared mapping the block is private to the process, hotkeys still go through it
+	void Open(bool bShared, const Settings& Initial)
+	{
+		if (bShared)
+		{
+			char Name[64];
+			_snprintf_s(Name, _TRUNCATE, "Local\\d3d9-wrapper-%lu", GetCurrentProcessId());
+
+			hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LimiterControlBlock), Name);
+			if (hMapping)
+				pBlock = static_cast<LimiterControlBlock*>(MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LimiterControlBlock)));
+			if (!pBlock)
+				pBlock = &LocalBlock;
+		}
+
+		pBlock->Magic = Magic;
+		pBlock->Size = sizeof(LimiterControlBlock);
+		pBlock->Sequence = 0;
+		pBlock->AppliedSequence = 0;
+		pBlock->FPSLimit = Initial.FPSLimit;
+		pBlock->FPSLimitMode = Initial.FPSLimitMode;
+		pBlock->DisplayFPSCounter = Initial.DisplayFPSCounter;
+		Publish(Initial);
+	}
+
+	// Makes a request from inside the process, the same way an external tool does
+	template <typename F>
+	void Request(F Change)
+	{
+		for (;;)
+		{
+			LONG Sequence = pBlock->Sequence;
+			if (!(Sequence & 1) && InterlockedCompareExchange(&pBlock->Sequence, Sequence + 1, Sequence) == Sequence)
+				break;
+			YieldProcessor();
+		}
+
+		Settings Requested = { pBlock->FPSLimit, pBlock->FPSLimitMode, pBlock->DisplayFPSCounter };
+		Change(Requested);
+		pBlock->FPSLimit = Requested.FPSLimit;
+		pBlock->FPSLimitMode = Requested.FPSLimitMode;
+		pBlock->DisplayFPSCounter = Requested.DisplayFPSCounter;
+
+		InterlockedIncrement(&pBlock->Sequence);
+	}
+
+	// Called once per frame: returns true with a consistent copy of a request that has not been applied yet
+	bool Poll(Settings& Requested)
+	{
+		LONG Sequence = pBlock->Sequence;
+		if ((Sequence & 1) || Sequence == pBlock->AppliedSequence)
+			return false;
+
+		MemoryBarrier();
+		Requested = { pBlock->FPSLimit, pBlock->FPSLimitMode, pBlock->DisplayFPSCounter };
+		MemoryBarrier();
+
+		// Changed while being read, the request is picked up on one of the next frames
+		if (pBlock->Sequence != Sequence)
+			return false;
+
+		pBlock->AppliedSequence = Sequence;
+		return true;
+	}
+
+	void Publish(const Settings& Current)
+	{
+		pBlock->CurrentFPSLimit = Current.FPSLimit;
+		pBlock->CurrentFPSLimitMode = Current.FPSLimitMode;
+		pBlock->CurrentDisplayFPSCounter = Current.DisplayFPSCounter;
+	}
+
+private:
+	LimiterControlBlock LocalBlock = {};
+	LimiterControlBlock* pBlock = &LocalBlock;
+	HANDLE hMapping = NULL;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+// Device state for one overlay element, as two state blocks recorded from the same list of state changes: one
+// with the element's values, the other filled with the application's by Capture right before each draw. They hold
+// exactly the states the element changes, so whatever the application has bound, saving, setting and restoring
+// costs three calls. Like any state block they must be released before a Reset and recorded again after it.
+class OverlayState
+{
+public:
+	template <typename F>
+	bool Record(IDirect3DDevice9* pDevice, F SetState)
+	{
+		Release();
+
+		IDirect3DStateBlock9** Blocks[] = { &pOverlayState, &pSavedState };
+		for (IDirect3DStateBlock9** ppBlock : Blocks)
+		{
+			if (FAILED(pDevice->BeginStateBlock()))
+			{
+				Release();
+				return false;
+			}
+
+			SetState(pDevice);
+
+			if (FAILED(pDevice->EndStateBlock(ppBlock)) || !*ppBlock)
+			{
+				*ppBlock = nullptr;
+				Release();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool IsRecorded() const { return pSavedState != nullptr; }
+
+	void Begin()
+	{
+		pSavedState->Capture();
+		pOverlayState->Apply();
+	}
+
+	void End()
+	{
+		pSavedState->Apply();
+	}
+
+	void Release()
+	{
+		if (pSavedState)
+			pSavedState->Release();
+		if (pOverlayState)
+			pOverlayState->Release();
+		pSavedState = nullptr;
+		pOverlayState = nullptr;
+	}
+
+private:
+	IDirect3DStateBlock9* pOverlayState = nullptr;
+	IDirect3DStateBlock9* pSavedState = nullptr;
+};
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <vector>
+#include "OverlayState.h"
+
+// Text for the on-screen overlay, without D3DX. The glyphs of two faces are rasterized once with GDI into an
+// atlas, each with a one pixel black outline already baked around it. Print only appends quads to a fixed
+// vertex array; Draw then sends all of them to the device in a single DrawPrimitiveUP.
+// The large face holds digits only, it never shows anything but the frame rate; the small one all of printable ASCII.
+// The atlas texture and the state blocks belong to a single device at a time; they are created on first use and
+// dropped by OnLostDevice(), so a Reset or a new device gets new ones on the next Draw.
+class OverlayText
+{
+public:
+	enum Face { Large, Small, FaceCount };
+
+	// Rasterizes the atlas, heights are character cell heights in pixels
+	bool Create(int LargeHeight, int SmallHeight)
+	{
+		Release();
+
+		const int Heights[FaceCount] = { LargeHeight, SmallHeight };
+		const char* Characters[FaceCount] = { "0123456789", nullptr };
+
+		HDC hDC = CreateCompatibleDC(NULL);
+		if (!hDC)
+			return false;
+
+		HFONT hFonts[FaceCount] = {};
+		for (int f = 0; f < FaceCount; f++)
+		{
+			hFonts[f] = CreateFontA(Heights[f] > 1 ? Heights[f] : 1, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+				OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Arial");
+		}
+
+		// Lays the glyphs out in rows, each cell holding the glyph, its outline and a gap to the next one
+		int x = 0, y = 0, RowHeight = 0;
+		for (int f = 0; f < FaceCount; f++)
+		{
+			if (!hFonts[f])
+				continue;
+
+			HGDIOBJ hOld = SelectObject(hDC, hFonts[f]);
+			TEXTMETRICA Metrics;
+			GetTextMetricsA(hDC, &Metrics);
+			LineHeights[f] = Metrics.tmHeight;
+
+			for (int c = FirstChar; c <= LastChar; c++)
+			{
+				if (Characters[f] && !strchr(Characters[f], c))
+					continue;
+
+				char Char = (char)c;
+				SIZE Extent;
+				if (!GetTextExtentPoint32A(hDC, &Char, 1, &Extent))
+					continue;
+
+				Glyph& g = Glyphs[f][c - FirstChar];
+				g.Width = (short)(Extent.cx + 2 * Outline);
+				g.Height = (short)(Extent.cy + 2 * Outline);
+				g.Advance = (short)Extent.cx;
+				g.bValid = c != ' ';
+				if (!g.bValid)
+					continue;
+
+				if (x + g.Width + Gap > AtlasWidth)
+				{
+					x = 0;
+					y += RowHeight;
+					RowHeight = 0;
+				}
+				g.X = (short)x;
+				g.Y = (short)y;
+				x += g.Width + Gap;
+				if (g.Height + Gap > RowHeight)
+					RowHeight = g.Height + Gap;
+			}
+			SelectObject(hDC, hOld);
+		}
+
+		AtlasHeight = 1;
+		while (AtlasHeight < y + RowHeight)
+			AtlasHeight *= 2;
+
+		// White glyphs on black, so any channel of the bitmap is the glyph's coverage
+		BITMAPINFO Info = {};
+		Info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		Info.bmiHeader.biWidth = AtlasWidth;
+		Info.bmiHeader.biHeight = -AtlasHeight;
+		Info.bmiHeader.biPlanes = 1;
+		Info.bmiHeader.biBitCount = 32;
+		Info.bmiHeader.biCompression = BI_RGB;
+
+		DWORD* pBits = nullptr;
+		HBITMAP hBitmap = CreateDIBSection(hDC, &Info, DIB_RGB_COLORS, (void**)&pBits, NULL, 0);
+		if (hBitmap && pBits)
+		{
+			HGDIOBJ hOldBitmap = SelectObject(hDC, hBitmap);
+			memset(pBits, 0, AtlasWidth * AtlasHeight * sizeof(DWORD));
+			SetTextColor(hDC, RGB(255, 255, 255));
+			SetBkMode(hDC, TRANSPARENT);
+
+			for (int f = 0; f < FaceCount; f++)
+			{
+				if (!hFonts[f])
+					continue;
+
+				HGDIOBJ hOld = SelectObject(hDC, hFonts[f]);
+				for (int c = FirstChar; c <= LastChar; c++)
+				{
+					const Glyph& g = Glyphs[f][c - FirstChar];
+					char Char = (char)c;
+					if (g.bValid)
+						TextOutA(hDC, g.X + Outline, g.Y + Outline, &Char, 1);
+				}
+				SelectObject(hDC, hOld);
+			}
+			GdiFlush();
+
+			BakeOutline(pBits);
+			SelectObject(hDC, hOldBitmap);
+		}
+
+		if (hBitmap)
+			DeleteObject(hBitmap);
+		for (int f = 0; f < FaceCount; f++)
+		{
+			if (hFonts[f])
+				DeleteObject(hFonts[f]);
+		}
+		DeleteDC(hDC);
+
+		return !Pixels.empty();
+	}
+
+	bool IsCreated() const { return !Pixels.empty(); }
+	int GetLineHeight(Face f) const { return LineHeights[f]; }
+
+	// Appends a string whose top left corner is at X, Y; characters the face does not hold are skipped
+	void Print(Face f, float X, float Y, D3DCOLOR Color, const char* Format, ...)
+	{
+		char Buffer[128];
+		va_list Args;
+		va_start(Args, Format);
+		_vsnprintf_s(Buffer, _TRUNCATE, Format, Args);
+		va_end(Args);
+
+		// Pixel centers sit on integer coordinates, the half pixel puts texels right onto them
+		float PenX = (float)(int)X - Outline - 0.5f;
+		float PenY = (float)(int)Y - Outline - 0.5f;
+		for (const char* p = Buffer; *p; p++)
+		{
+			unsigned char c = (unsigned char)*p;
+			if (c < FirstChar || c > LastChar)
+				continue;
+
+			const Glyph& g = Glyphs[f][c - FirstChar];
+			if (g.bValid && VertexCount + 6 <= MaxVertices)
+			{
+				float x0 = PenX, y0 = PenY, x1 = PenX + g.Width, y1 = PenY + g.Height;
+				float u0 = (float)g.X / AtlasWidth, v0 = (float)g.Y / AtlasHeight;
+				float u1 = (float)(g.X + g.Width) / AtlasWidth, v1 = (float)(g.Y + g.Height) / AtlasHeight;
+
+				Vertex* v = &Vertices[VertexCount];
+				v[0] = { x0, y0, 0.0f, 1.0f, Color, u0, v0 };
+				v[1] = { x1, y0, 0.0f, 1.0f, Color, u1, v0 };
+				v[2] = { x0, y1, 0.0f, 1.0f, Color, u0, v1 };
+				v[3] = v[2];
+				v[4] = v[1];
+				v[5] = { x1, y1, 0.0f, 1.0f, Color, u1, v1 };
+				VertexCount += 6;
+			}
+			PenX += g.Advance;
+		}
+	}
+
+	// Draws everything printed since the last call, the device's state is left as it was found
+	void Draw(IDirect3DDevice9* pDevice)
+	{
+		if (!VertexCount)
+			return;
+
+		if (pDevice != pTextureDevice)
+		{
+			OnLostDevice();
+			pTextureDevice = pDevice;
+		}
+		// The texture is part of the recorded state, so it is uploaded first
+		if ((!pTexture && !Upload(pDevice)) ||
+			(!State.IsRecorded() && !State.Record(pDevice, [this](IDirect3DDevice9* pRecording) { SetState(pRecording); })))
+		{
+			VertexCount = 0;
+			return;
+		}
+
+		State.Begin();
+		pDevice->DrawPrimitiveUP(D3DPT_TRIANGLELIST, VertexCount / 3, Vertices, sizeof(Vertex));
+		State.End();
+
+		VertexCount = 0;
+	}
+
+	// Before Reset, the texture and state blocks are created again on the next Draw
+	void OnLostDevice()
+	{
+		State.Release();
+		if (pTexture)
+			pTexture->Release();
+		pTexture = nullptr;
+		pTextureDevice = nullptr;
+	}
+
+	void Release()
+	{
+		OnLostDevice();
+		std::vector<DWORD>().swap(Pixels);
+		memset(Glyphs, 0, sizeof(Glyphs));
+		memset(LineHeights, 0, sizeof(LineHeights));
+		VertexCount = 0;
+	}
+
+private:
+	static constexpr int FirstChar = 32;
+	static constexpr int LastChar = 126;
+	static constexpr int Outline = 1;				// Pixels of outline around each glyph
+	static constexpr int Gap = 1;					// Between cells, so filtering never picks up a neighbour
+	static constexpr int AtlasWidth = 1024;
+	static constexpr UINT MaxVertices = 6 * 256;
+	static constexpr DWORD FVF = D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1;
+
+	struct Glyph
+	{
+		short X, Y;				// Cell in the atlas, outline included
+		short Width, Height;
+		short Advance;
+		bool bValid;
+	};
+
+	struct Vertex
+	{
+		float x, y, z, rhw;
+		D3DCOLOR Color;
+		float u, v;
+	};
+
+	// Same cross pattern the outline used to be drawn with: the glyph shifted by one pixel in four directions.
+	// Texels keep the glyph's coverage as white over the outline's black, so vertex colors only tint the glyph.
+	void BakeOutline(const DWORD* pCoverage)
+	{
+		Pixels.resize(AtlasWidth * AtlasHeight);
+
+		auto Coverage = [&](int x, int y) -> DWORD
+			{
+				return x < 0 || y < 0 || x >= AtlasWidth || y >= AtlasHeight ? 0 : pCoverage[y * AtlasWidth + x] & 0xFF;
+			};
+
+		for (int y = 0; y < AtlasHeight; y++)
+		{
+			for (int x = 0; x < AtlasWidth; x++)
+			{
+				DWORD Inside = Coverage(x, y);
+				DWORD Alpha = Inside;
+				DWORD Neighbours[4] = { Coverage(x - 1, y), Coverage(x + 1, y), Coverage(x, y - 1), Coverage(x, y + 1) };
+				for (DWORD n : Neighbours)
+				{
+					if (n > Alpha)
+						Alpha = n;
+				}
+
+				DWORD Gray = Alpha ? Inside * 255 / Alpha : 0;
+				Pixels[y * AtlasWidth + x] = D3DCOLOR_ARGB(Alpha, Gray, Gray, Gray);
+			}
+		}
+	}
+
+	// Goes through system memory, so it works the same for plain and Ex devices, which have no managed pool
+	bool Upload(IDirect3DDevice9* pDevice)
+	{
+		D3DCAPS9 Caps;
+		if (Pixels.empty() || FAILED(pDevice->GetDeviceCaps(&Caps)) || (DWORD)AtlasWidth > Caps.MaxTextureWidth || (DWORD)AtlasHeight > Caps.MaxTextureHeight)
+			return false;
+
+		IDirect3DTexture9* pStaging = nullptr;
+		if (FAILED(pDevice->CreateTexture(AtlasWidth, AtlasHeight, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &pStaging, NULL)) || !pStaging)
+			return false;
+
+		D3DLOCKED_RECT Locked;
+		if (SUCCEEDED(pStaging->LockRect(0, &Locked, NULL, 0)))
+		{
+			for (int y = 0; y < AtlasHeight; y++)
+				memcpy((BYTE*)Locked.pBits + y * Locked.Pitch, &Pixels[y * AtlasWidth], AtlasWidth * sizeof(DWORD));
+			pStaging->UnlockRect(0);
+
+			if (FAILED(pDevice->CreateTexture(AtlasWidth, AtlasHeight, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &pTexture, NULL)) ||
+				FAILED(pDevice->UpdateTexture(pStaging, pTexture)))
+			{
+				if (pTexture)
+					pTexture->Release();
+				pTexture = nullptr;
+			}
+		}
+
+		pStaging->Release();
+		return pTexture != nullptr;
+	}
+
+	// Fixed function, pretransformed vertices, alpha blended and unaffected by depth, stencil or clipping.
+	// DrawPrimitiveUP leaves stream 0 unset, which is why it is part of the state too.
+	void SetState(IDirect3DDevice9* pDevice)
+	{
+		pDevice->SetVertexShader(NULL);
+		pDevice->SetPixelShader(NULL);
+		pDevice->SetFVF(FVF);
+		pDevice->SetStreamSource(0, NULL, 0, 0);
+		pDevice->SetTexture(0, pTexture);
+
+		pDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+		pDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+		pDevice->SetRenderState(D3DRS_SEPARATEALPHABLENDENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+		pDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+		pDevice->SetRenderState(D3DRS_BLENDOP, D3DBLENDOP_ADD);
+		pDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+		pDevice->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
+		pDevice->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_CLIPPLANEENABLE, 0);
+		pDevice->SetRenderState(D3DRS_FOGENABLE, FALSE);
+		pDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+		pDevice->SetRenderState(D3DRS_SRGBWRITEENABLE, FALSE);
+
+		pDevice->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+		pDevice->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+		pDevice->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+		pDevice->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+		pDevice->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+		pDevice->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+		pDevice->SetTextureStageState(0, D3DTSS_TEXCOORDINDEX, 0);
+		pDevice->SetTextureStageState(0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE);
+		pDevice->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+		pDevice->SetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+
+		pDevice->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+		pDevice->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+		pDevice->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+		pDevice->SetSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
+		pDevice->SetSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
+		pDevice->SetSamplerState(0, D3DSAMP_SRGBTEXTURE, FALSE);
+	}
+
+	std::vector<DWORD> Pixels;						// Atlas in A8R8G8B8, kept to upload again after a Reset
+	int AtlasHeight = 0;
+	Glyph Glyphs[FaceCount][LastChar - FirstChar + 1] = {};
+	int LineHeights[FaceCount] = {};
+
+	IDirect3DDevice9* pTextureDevice = nullptr;
+	IDirect3DTexture9* pTexture = nullptr;
+	OverlayState State;
+
+	Vertex Vertices[MaxVertices] = {};
+	UINT VertexCount = 0;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+// Where the display is scanning out. Implemented over the device and over swap chains, and by anything else
+// that can stand in for them, since RasterBand only ever sees raster statuses through this interface.
+class RasterSource
+{
+public:
+	virtual bool GetRasterStatus(D3DRASTER_STATUS& Status) = 0;
+};
+
+class DeviceRasterSource : public RasterSource
+{
+public:
+	explicit DeviceRasterSource(IDirect3DDevice9* pDevice) : pDevice(pDevice) {}
+	bool GetRasterStatus(D3DRASTER_STATUS& Status) override { return SUCCEEDED(pDevice->GetRasterStatus(0, &Status)); }
+
+private:
+	IDirect3DDevice9* pDevice;
+};
+
+class SwapChainRasterSource : public RasterSource
+{
+public:
+	explicit SwapChainRasterSource(IDirect3DSwapChain9* pSwapChain) : pSwapChain(pSwapChain) {}
+	bool GetRasterStatus(D3DRASTER_STATUS& Status) override { return SUCCEEDED(pSwapChain->GetRasterStatus(&Status)); }
+
+private:
+	IDirect3DSwapChain9* pSwapChain;
+};
+
+// Decides whether a Present issued now puts the tear line inside a band of the screen, given as fractions
+// of its height (0 is the top, 1 the bottom). The vertical blank is always inside, nothing tears there.
+// The height is learned from the scanlines seen before each wrap back to the top, so no display mode is needed.
+// Drivers that fail the call, or keep reporting line 0 outside of a vertical blank, are taken as unsupported.
+class RasterBand
+{
+public:
+	enum Position { Inside, Outside, Unknown, Unsupported };
+
+	void Configure(double Top, double Bottom)
+	{
+		BandTop = Top;
+		BandBottom = Bottom;
+		Height = 0;
+		MaxScanLine = 0;
+		LastScanLine = 0;
+		ZeroReads = 0;
+		bUnsupported = false;
+	}
+
+	bool IsUnsupported() const { return bUnsupported; }
+	UINT GetHeight() const { return Height; }
+
+	Position Poll(RasterSource& Source)
+	{
+		if (bUnsupported)
+			return Unsupported;
+
+		D3DRASTER_STATUS Status = {};
+		if (!Source.GetRasterStatus(Status))
+		{
+			bUnsupported = true;
+			return Unsupported;
+		}
+
+		if (Status.InVBlank)
+		{
+			ZeroReads = 0;
+			return Inside;
+		}
+
+		if (Status.ScanLine == 0)
+		{
+			if (++ZeroReads >= MaxZeroReads)
+				bUnsupported = true;
+			return bUnsupported ? Unsupported : Unknown;
+		}
+		ZeroReads = 0;
+
+		// Wrapped around to the top of the next refresh, the deepest line seen is the last visible one
+		if (Status.ScanLine < LastScanLine && MaxScanLine)
+			Height = MaxScanLine + 1;
+		if (Status.ScanLine > MaxScanLine)
+			MaxScanLine = Status.ScanLine;
+		LastScanLine = Status.ScanLine;
+
+		if (!Height)
+			return Unknown;
+
+		double Line = (double)Status.ScanLine / (double)Height;
+		return Line >= BandTop && Line <= BandBottom ? Inside : Outside;
+	}
+
+private:
+	static constexpr UINT MaxZeroReads = 64;
+
+	double BandTop = 0.0;
+	double BandBottom = 1.0;
+	UINT Height = 0;
+	UINT MaxScanLine = 0;
+	UINT LastScanLine = 0;
+	UINT ZeroReads = 0;
+	bool bUnsupported = false;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <new>
+
+// Fixed-size block allocator for wrapper objects. Blocks are carved out of slabs and recycled through
+// an intrusive free list, so creating a wrapper is a couple of pointer moves instead of a CRT heap call.
+// Slabs are only handed back to the heap, all at once, when the pool itself is destroyed.
+class WrapperPool
+{
+public:
+	struct Statistics
+	{
+		size_t SlabAllocations;		// Heap allocations made by the pool
+		size_t BlockAllocations;	// Wrappers handed out
+		size_t BlockFrees;			// Wrappers returned
+		size_t BlocksInUse;
+	};
+
+	WrapperPool() = default;
+	~WrapperPool()
+	{
+		while (Slabs)
+		{
+			Slab *Next = Slabs->Next;
+			::operator delete(Slabs);
+			Slabs = Next;
+		}
+	}
+
+	WrapperPool(const WrapperPool &) = delete;
+	WrapperPool &operator=(const WrapperPool &) = delete;
+
+	// Every allocation from one pool must request the same size
+	void *Allocate(size_t Size)
+	{
+		if (!BlockSize)
+		{
+			BlockSize = ((Size < sizeof(FreeBlock) ? sizeof(FreeBlock) : Size) + BlockAlignment - 1) & ~(BlockAlignment - 1);
+		}
+
+		if (!FreeList)
+		{
+			AllocateSlab();
+		}
+
+		FreeBlock *Block = FreeList;
+		FreeList = Block->Next;
+
+		Stats.BlockAllocations++;
+		Stats.BlocksInUse++;
+
+		return Block;
+	}
+
+	void Free(void *Block)
+	{
+		if (!Block)
+		{
+			return;
+		}
+
+		FreeBlock *Entry = static_cast<FreeBlock *>(Block);
+		Entry->Next = FreeList;
+		FreeList = Entry;
+
+		Stats.BlockFrees++;
+		Stats.BlocksInUse--;
+	}
+
+	const Statistics &GetStatistics() const { return Stats; }
+
+private:
+	static constexpr size_t BlockAlignment = 16;
+	static constexpr size_t BlocksPerSlab = 64;
+
+	struct FreeBlock
+	{
+		FreeBlock *Next;
+	};
+
+	struct Slab
+	{
+		Slab *Next;
+	};
+
+	static constexpr size_t SlabHeaderSize = (sizeof(Slab) + BlockAlignment - 1) & ~(BlockAlignment - 1);
+
+	void AllocateSlab()
+	{
+		Slab *NewSlab = static_cast<Slab *>(::operator new(SlabHeaderSize + BlockSize * BlocksPerSlab));
+		NewSlab->Next = Slabs;
+		Slabs = NewSlab;
+
+		// Thread the new blocks onto the free list in address order
+		char *Blocks = reinterpret_cast<char *>(NewSlab) + SlabHeaderSize;
+		for (size_t i = BlocksPerSlab; i-- > 0;)
+		{
+			FreeBlock *Block = reinterpret_cast<FreeBlock *>(Blocks + i * BlockSize);
+			Block->Next = FreeList;
+			FreeList = Block;
+		}
+
+		Stats.SlabAllocations++;
+	}
+
+	size_t BlockSize = 0;
+	Slab *Slabs = nullptr;
+	FreeBlock *FreeList = nullptr;
+	Statistics Stats = {};
+};
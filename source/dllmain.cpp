@@ -15,13 +15,26 @@
 */
 
 #include "d3d9.h"
-#include "d3dx9.h"
 #include "iathook.h"
+#include "vtablehook.h"
+#include "FramePacer.h"
+#include "RasterBand.h"
+#include "FrameQueue.h"
+#include "FrameStats.h"
+#include "FrameCapture.h"
+#include "LimiterControl.h"
+#include "OverlayText.h"
+#include "FrameGraph.h"
+#include "GpuTimer.h"
 #include "helpers.h"
+#include <vector>
 
-#pragma comment(lib, "d3dx9.lib")
 #pragma comment(lib, "winmm.lib") // needed for timeBeginPeriod()/timeEndPeriod()
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 // Windows 10 1803+
+#endif
+
 Direct3DShaderValidatorCreate9Proc m_pDirect3DShaderValidatorCreate9;
 PSGPErrorProc m_pPSGPError;
 PSGPSampleTextureProc m_pPSGPSampleTexture;
@@ -49,9 +62,20 @@ bool bCenterWindow;
 bool bAlwaysOnTop;
 bool bDoNotNotifyOnTaskSwitch;
 bool bDisplayFPSCounter;
+bool bDisplayFrameTimeGraph;
 bool bEnableHooks;
 bool bCaptureMouse;
-float fFPSLimit;
+bool bWrapResources;
+bool bFPSLimitAfterPresent;
+bool bFrameCapture;
+int nFPSLimitModeSetting;
+int nHotkeyFPSLimitUp;
+int nHotkeyFPSLimitDown;
+int nHotkeyFPSLimitMode;
+int nHotkeyDisplayFPSCounter;
+double fHotkeyFPSLimitStep;
+int nInterceptionMode;
+double fFPSLimit;
 int nFullScreenRefreshRateInHz;
 int nForceWindowStyle;
 
@@ -67,190 +91,826 @@ LRESULT WINAPI CustomWndProcW(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
 
 class FrameLimiter
 {
+public:
+	enum FPSLimitMode { FPS_NONE, FPS_REALTIME, FPS_ACCURATE, FPS_WAITABLE, FPS_RASTER };
+
+	// Pacing and measurements of one swap chain. Chains are told apart by the runtime object that presents,
+	// the device itself standing for its implicit swap chain, so both interception modes use the same keys.
+	struct ChainState
+	{
+		const void* Key;
+		UINT Index;				// Order in which the chain first presented
+		bool bLimited;
+		LONGLONG LastPresent;
+		volatile LONG Users;	// Limiter calls in progress on the chain, its slot is not taken over while there are any
+
+		FramePacer Pacer;
+		double PacedLimit;		// Rate the pacer was started with, it restarts when the applicable limit changes
+		RasterBand Raster;		// FPS_RASTER
+
+		// FPS_WAITABLE state, in performance counter ticks
+		HANDLE hFrameTimer;
+		LONGLONG WT_SpinTail;
+		LONGLONG WT_Oversleep;
+
+		// Time spent inside the limiter, collected over one second windows
+		LONGLONG WAIT_WindowStart;
+		LONGLONG WAIT_Ticks;
+		ULONGLONG WAIT_CpuTime;
+		UINT WAIT_Frames;
+		LONGLONG WAIT_Start;
+		ULONGLONG WAIT_StartCpuTime;
+		LONGLONG WAIT_Last;		// The most recent wait on its own, for captures
+
+		// Time from handing control back to the application to it presenting the next frame, in the same windows
+		LONGLONG LAT_FrameStart;
+		LONGLONG LAT_Ticks;
+		UINT LAT_Frames;
+
+		double WaitMsPerFrame;		// Wall time spent waiting, per frame
+		double WaitCpuPercent;		// Share of that time the thread spent on a CPU
+		double LatencyMs;			// Age of the application's frame when it reaches Present
+	};
+
 private:
-	static inline double TIME_Frequency = 0.0;
-	static inline double TIME_Ticks = 0.0;
-	static inline double TIME_Frametime = 0.0;
+	static constexpr UINT MaxChains = 8;
+
+	static inline LONGLONG TIME_Frequency = 0;
+	static inline DWORD WT_TimerFlags = 0;
+	static inline LONGLONG WT_InitialTail = 0;
+
+	static inline ChainState Chains[MaxChains] = {};
+	static inline UINT ChainCount = 0;
+	static inline UINT NextChainIndex = 0;
+	static inline SRWLOCK ChainLock = SRWLOCK_INIT;
+
+	static inline ULONGLONG BG_NextCheck = 0;
+	static inline volatile LONG BG_CheckRequested = 0;
 
 public:
-	static inline ID3DXFont* pFPSFont = nullptr;
-	static inline ID3DXFont* pTimeFont = nullptr;
+	static inline bool bTimerPeriodSet = false;
+	static inline int nLimitedChain = -1;			// Index of the only chain that is limited, or -1 to limit each one
+	static inline double fRasterBandTop = 0.0;		// FPS_RASTER band, as fractions of the screen height
+	static inline double fRasterBandBottom = 0.05;
+
+	// Applied while the focus window is inactive, minimized or occluded
+	enum BackgroundState { BG_FOREGROUND, BG_INACTIVE, BG_HIDDEN };
+	enum BackgroundSkip { SKIP_NONE, SKIP_HIDDEN, SKIP_BACKGROUND };
+	static inline double fBackgroundFPSLimit = 0.0;
+	static constexpr double SkipFPSLimit = 30.0;		// Skipped frames never block in the runtime, without a background limit they are held to this
+	static inline BackgroundSkip nBackgroundSkip = SKIP_NONE;
+	static inline BackgroundState Background = BG_FOREGROUND;
+	static inline bool bOccluded = false;
+
+	static inline FrameQueue Queue;					// MaxFramesInFlight, independent of the limiter mode
+	static inline FrameStats<> Stats;				// Times between the presents of the overlay's swap chain
+	static inline FrameCapture Capture;				// Per-frame records written to disk, see FrameCapture.h
+
+	static inline OverlayText Text;					// Overlay glyph atlas and the batch of quads it draws
+	static inline FrameGraph Graph;					// Frame time graph, DisplayFrameTimeGraph
+	static inline GpuTimer Gpu;						// GPU time of the overlay's swap chain frames, while the overlay shows
+	static inline const void* pOverlayChain = nullptr;
+	static inline LONGLONG OverlayLastPresent = 0;
+	static inline LONGLONG OverlayLastSample = 0;
 
 public:
-	enum FPSLimitMode { FPS_NONE, FPS_REALTIME, FPS_ACCURATE };
+	static inline FPSLimitMode ActiveMode = FPS_NONE;
+	// May be called again between frames to switch modes, each chain's pacer restarts on its next wait
 	static void Init(FPSLimitMode mode)
 	{
-		LARGE_INTEGER frequency;
+		ActiveMode = mode;
 
+		LARGE_INTEGER frequency;
 		QueryPerformanceFrequency(&frequency);
-		static constexpr auto TICKS_PER_FRAME = 1;
-		auto TICKS_PER_SECOND = (TICKS_PER_FRAME * fFPSLimit);
-		if (mode == FPS_ACCURATE)
+		TIME_Frequency = frequency.QuadPart;
+
+		for (UINT i = 0; i < ChainCount; i++)
+			Chains[i].PacedLimit = 0.0;
+
+		if ((mode == FPS_ACCURATE || mode == FPS_RASTER) && !bTimerPeriodSet)
+		{
+			timeBeginPeriod(1);
+			bTimerPeriodSet = true;
+		}
+
+		if (mode == FPS_WAITABLE && !WT_InitialTail)
 		{
-			TIME_Frametime = 1000.0 / (double)fFPSLimit;
-			TIME_Frequency = (double)frequency.QuadPart / 1000.0; // ticks are milliseconds
+			// A high resolution timer wakes within a few hundred microseconds without raising the system timer
+			// resolution. Older systems get a regular timer, which needs timeBeginPeriod and a longer spin tail.
+			if (HANDLE hProbe = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS))
+			{
+				CloseHandle(hProbe);
+				WT_TimerFlags = CREATE_WAITABLE_TIMER_HIGH_RESOLUTION;
+				WT_InitialTail = TIME_Frequency / 2000; // 0.5ms
+			}
+			else
+			{
+				WT_TimerFlags = 0;
+				WT_InitialTail = TIME_Frequency / 500; // 2ms
+				if (!bTimerPeriodSet)
+					timeBeginPeriod(1);
+				bTimerPeriodSet = true;
+			}
 		}
-		else // FPS_REALTIME
+	}
+	// Setting values are those of FPSLimitMode in d3d9.ini
+	static FPSLimitMode ModeFromSetting(int setting)
+	{
+		switch (setting)
 		{
-			TIME_Frequency = (double)frequency.QuadPart / (double)TICKS_PER_SECOND; // ticks are 1/n frames (n = fFPSLimit)
+		case 2: return FPS_ACCURATE;
+		case 3: return FPS_WAITABLE;
+		case 4: return FPS_RASTER;
+		default: return FPS_REALTIME;
 		}
-		Ticks();
 	}
-	static DWORD Sync_RT()
+	// The raster position only means something right before the frame goes out
+	static bool IsWaitingAfterPresent()
 	{
-		DWORD lastTicks, currentTicks;
-		LARGE_INTEGER counter;
+		return bFPSLimitAfterPresent && ActiveMode != FPS_RASTER;
+	}
+	// Returns the state of the chain presenting through Key, taking over the longest idle slot for a new chain.
+	// The slot is held until ReleaseChain; nullptr when every slot is held by a chain presenting right now.
+	static ChainState* AcquireChain(const void* Key)
+	{
+		AcquireSRWLockExclusive(&ChainLock);
 
-		QueryPerformanceCounter(&counter);
-		lastTicks = (DWORD)TIME_Ticks;
-		TIME_Ticks = (double)counter.QuadPart / TIME_Frequency;
-		currentTicks = (DWORD)TIME_Ticks;
+		ChainState* pChain = nullptr;
+		for (UINT i = 0; i < ChainCount && !pChain; i++)
+		{
+			if (Chains[i].Key == Key)
+				pChain = &Chains[i];
+		}
 
-		return (currentTicks > lastTicks) ? currentTicks - lastTicks : 0;
+		if (!pChain)
+		{
+			if (ChainCount < MaxChains)
+			{
+				pChain = &Chains[ChainCount++];
+			}
+			else
+			{
+				for (UINT i = 0; i < MaxChains; i++)
+				{
+					if (!Chains[i].Users && (!pChain || Chains[i].LastPresent < pChain->LastPresent))
+						pChain = &Chains[i];
+				}
+				if (!pChain)
+				{
+					ReleaseSRWLockExclusive(&ChainLock);
+					return nullptr;
+				}
+				if (pChain->hFrameTimer)
+					CloseHandle(pChain->hFrameTimer);
+			}
+
+			*pChain = {};
+			pChain->Key = Key;
+			pChain->Index = NextChainIndex++;
+			pChain->bLimited = nLimitedChain < 0 || (UINT)nLimitedChain == pChain->Index;
+			pChain->Raster.Configure(fRasterBandTop, fRasterBandBottom);
+		}
+
+		pChain->LastPresent = Ticks();
+		InterlockedIncrement(&pChain->Users);
+
+		ReleaseSRWLockExclusive(&ChainLock);
+
+		return pChain;
 	}
-	static DWORD Sync_SLP()
+	static void ReleaseChain(ChainState& Chain)
 	{
-		LARGE_INTEGER counter;
-		QueryPerformanceCounter(&counter);
-		double millis_current = (double)counter.QuadPart / TIME_Frequency;
-		double millis_delta = millis_current - TIME_Ticks;
-		if (TIME_Frametime <= millis_delta)
+		InterlockedDecrement(&Chain.Users);
+	}
+	// The chain whose numbers the overlay shows: the limited one, or the first to present when each is limited
+	static const ChainState* GetDisplayedChain()
+	{
+		UINT Index = nLimitedChain < 0 ? 0 : (UINT)nLimitedChain;
+		for (UINT i = 0; i < ChainCount; i++)
+		{
+			if (Chains[i].Index == Index)
+				return &Chains[i];
+		}
+		return ChainCount ? &Chains[0] : nullptr;
+	}
+	static DWORD Sync_RT(ChainState& Chain)
+	{
+		LONGLONG now = Ticks();
+		if (now < Chain.Pacer.GetDeadline())
+			return 0;
+
+		Chain.Pacer.Advance(now);
+		return 1;
+	}
+	static DWORD Sync_SLP(ChainState& Chain)
+	{
+		LONGLONG now = Ticks();
+		LONGLONG remaining = Chain.Pacer.GetDeadline() - now;
+		if (remaining <= 0)
 		{
-			TIME_Ticks = millis_current;
+			Chain.Pacer.Advance(now);
 			return 1;
 		}
-		else if (TIME_Frametime - millis_delta > 2.0) // > 2ms
+		else if (remaining > TIME_Frequency / 500) // > 2ms
 			Sleep(1); // Sleep for ~1ms
 		else
 			Sleep(0); // yield thread's time-slice (does not actually sleep)
 
 		return 0;
 	}
-	static void ShowFPS(LPDIRECT3DDEVICE9EX device)
+	static void Sync_WT(ChainState& Chain)
 	{
-		static std::list<int> m_times;
+		LONGLONG now = Ticks();
+		LONGLONG target = Chain.Pacer.GetDeadline();
+		LONGLONG remaining = target - now;
 
-		//https://github.com/microsoft/VCSamples/blob/master/VC2012Samples/Windows%208%20samples/C%2B%2B/Windows%208%20app%20samples/Direct2D%20geometry%20realization%20sample%20(Windows%208)/C%2B%2B/FPSCounter.cpp#L279
-		LARGE_INTEGER frequency;
-		LARGE_INTEGER time;
-		QueryPerformanceFrequency(&frequency);
-		QueryPerformanceCounter(&time);
+		// Chains that presented before this mode was selected get their timer now
+		if (!Chain.hFrameTimer && !Chain.WT_SpinTail)
+		{
+			Chain.hFrameTimer = CreateWaitableTimerExW(NULL, NULL, WT_TimerFlags, TIMER_ALL_ACCESS);
+			Chain.WT_SpinTail = WT_InitialTail;
+		}
+
+		// Sleep through most of the interval and leave the rest to a short spin, which absorbs the timer's wake-up latency
+		if (remaining > Chain.WT_SpinTail && Chain.hFrameTimer)
+		{
+			LONGLONG sleep = remaining - Chain.WT_SpinTail;
+			LARGE_INTEGER due;
+			due.QuadPart = -(sleep * 10000000 / TIME_Frequency); // relative, in 100ns units
+
+			if (SetWaitableTimer(Chain.hFrameTimer, &due, 0, NULL, NULL, FALSE))
+			{
+				WaitForSingleObject(Chain.hFrameTimer, INFINITE);
+
+				// Calibrate the tail against how late the timer actually wakes us, averaged over the last few frames
+				LONGLONG oversleep = Ticks() - (now + sleep);
+				Chain.WT_Oversleep += ((oversleep > 0 ? oversleep : 0) - Chain.WT_Oversleep) / 8;
 
-		if (m_times.size() == 50)
-			m_times.pop_front();
-		m_times.push_back(static_cast<int>(time.QuadPart));
+				LONGLONG tail = Chain.WT_Oversleep * 2 + TIME_Frequency / 10000; // twice the usual lateness plus 0.1ms
+				LONGLONG minTail = TIME_Frequency / 5000;						// 0.2ms
+				LONGLONG maxTail = bTimerPeriodSet ? TIME_Frequency / 250 : TIME_Frequency / 500; // 4ms / 2ms
+				Chain.WT_SpinTail = tail < minTail ? minTail : tail > maxTail ? maxTail : tail;
+			}
+		}
 
-		uint32_t fps = 0;
-		if (m_times.size() >= 2)
-			fps = static_cast<uint32_t>(0.5f + (static_cast<float>(m_times.size() - 1) * static_cast<float>(frequency.QuadPart)) / static_cast<float>(m_times.back() - m_times.front()));
+		while ((now = Ticks()) < target)
+			YieldProcessor();
+
+		Chain.Pacer.Advance(now);
+	}
+	// Looks at the focus window at most every 100ms, or at once after a focus change was seen in its window procedure
+	static bool IsWatchingBackground()
+	{
+		return fBackgroundFPSLimit > 0.0 || nBackgroundSkip != SKIP_NONE;
+	}
+	static void UpdateBackground(IDirect3DDevice9* pDevice)
+	{
+		if (!IsWatchingBackground())
+			return;
+
+		ULONGLONG now = GetTickCount64();
+		if (now < BG_NextCheck && !InterlockedExchange(&BG_CheckRequested, 0))
+			return;
+		BG_NextCheck = now + 100;
+
+		HWND hWnd = g_hFocusWindow;
+		bool bMinimized = hWnd && IsIconic(hWnd);
+
+		// Presents report occlusion by themselves, but skipped ones do not, so the device is asked instead
+		IDirect3DDevice9Ex* pDeviceEx = nullptr;
+		if (bOccluded && pDevice && SUCCEEDED(pDevice->QueryInterface(IID_IDirect3DDevice9Ex, (void**)&pDeviceEx)) && pDeviceEx)
+		{
+			bOccluded = pDeviceEx->CheckDeviceState(hWnd) == S_PRESENT_OCCLUDED;
+			pDeviceEx->Release();
+		}
+
+		DWORD dwPID = 0;
+		HWND hForeground = GetForegroundWindow();
+		if (hForeground)
+			GetWindowThreadProcessId(hForeground, &dwPID);
+
+		Background = bMinimized || bOccluded ? BG_HIDDEN : dwPID != GetCurrentProcessId() ? BG_INACTIVE : BG_FOREGROUND;
+	}
+	static void RequestBackgroundCheck()
+	{
+		InterlockedExchange(&BG_CheckRequested, 1);
+	}
+	// Skipped frames have no result of their own, UpdateBackground keeps track of the occlusion meanwhile
+	static void OnPresentResult(HRESULT hr)
+	{
+		if (!IsSkippingPresent())
+			bOccluded = hr == S_PRESENT_OCCLUDED;
+	}
+	static bool IsSkippingPresent()
+	{
+		return (nBackgroundSkip == SKIP_HIDDEN && Background == BG_HIDDEN) || (nBackgroundSkip == SKIP_BACKGROUND && Background != BG_FOREGROUND);
+	}
+	// Paces like FPS_ACCURATE up to the deadline, then holds Present until the scanline is inside the band, so the tear
+	// line of an unsynchronized Present lands there. Without a raster source, or with a driver that does not report
+	// the raster position, it is left at plain pacing.
+	static void Sync_RB(ChainState& Chain, RasterSource* pRaster)
+	{
+		LONGLONG now;
+		while ((now = Ticks()) < Chain.Pacer.GetDeadline())
+		{
+			if (Chain.Pacer.GetDeadline() - now > TIME_Frequency / 500) // > 2ms
+				Sleep(1);
+			else
+				Sleep(0);
+		}
+
+		if (pRaster)
+		{
+			// The band comes round once per refresh, giving up after a frame keeps a band the display never
+			// reaches (a stopped scanout, or one narrower than the polling interval) from stalling the game
+			LONGLONG giveUp = now + Chain.Pacer.GetPeriod();
+			RasterBand::Position position;
+			while ((position = Chain.Raster.Poll(*pRaster)) != RasterBand::Inside && position != RasterBand::Unsupported && (now = Ticks()) < giveUp)
+				YieldProcessor();
+			now = Ticks();
+		}
+
+		Chain.Pacer.Advance(now);
+	}
+	// Chains that are not limited still go through here, so their wait and latency numbers stay comparable
+	static void Wait(ChainState& Chain, RasterSource* pRaster)
+	{
+		BeginWait(Chain);
+
+		// In the background every chain is held to the background limit, if there is one, and while its frames
+		// are skipped to SkipFPSLimit, or to a lower FPSLimit it is already held to
+		bool bBackground = Background != BG_FOREGROUND && fBackgroundFPSLimit > 0.0;
+		double limit = bBackground ? fBackgroundFPSLimit : fFPSLimit;
+		if (!bBackground && IsSkippingPresent())
+		{
+			bBackground = true;
+			if (!Chain.bLimited || !(fFPSLimit > 0.0 && fFPSLimit < SkipFPSLimit))
+				limit = SkipFPSLimit;
+		}
+		if ((Chain.bLimited || bBackground) && limit > 0.0)
+		{
+			if (Chain.PacedLimit != limit)
+			{
+				Chain.PacedLimit = limit;
+				Chain.Pacer.Start(limit, TIME_Frequency, Ticks());
+			}
+
+			if (ActiveMode == FPS_REALTIME)
+				while (!Sync_RT(Chain));
+			else if (ActiveMode == FPS_ACCURATE)
+				while (!Sync_SLP(Chain));
+			else if (ActiveMode == FPS_WAITABLE)
+				Sync_WT(Chain);
+			else if (ActiveMode == FPS_RASTER)
+				Sync_RB(Chain, pRaster);
+		}
+
+		EndWait(Chain);
+	}
+	// The application starts work on a frame, and samples its input, once the wrapper returns from Present.
+	// Whatever it then spends until the next Present, including a limiter wait before it, is time the frame ages.
+	static void BeginPresent(ChainState& Chain)
+	{
+		LONGLONG now = Ticks();
+
+		if (Chain.LAT_FrameStart)
+		{
+			Chain.LAT_Ticks += now - Chain.LAT_FrameStart;
+			Chain.LAT_Frames++;
+		}
+
+		if (Capture.IsRunning())
+		{
+			// A wait before Present falls inside the span since the last one, a wait after it does not
+			LONGLONG cpu = Chain.LAT_FrameStart ? now - Chain.LAT_FrameStart : 0;
+			if (!IsWaitingAfterPresent())
+				cpu -= Chain.WAIT_Last;
+
+			FrameRecord record = { now, (float)((double)Chain.WAIT_Last * 1000.0 / (double)TIME_Frequency),
+				(float)((double)(cpu > 0 ? cpu : 0) * 1000.0 / (double)TIME_Frequency), Chain.Index, 0 };
+			Capture.Push(record);
+		}
+	}
+	static void EndPresent(ChainState& Chain)
+	{
+		Chain.LAT_FrameStart = Ticks();
+	}
+	static void BeginWait(ChainState& Chain)
+	{
+		Chain.WAIT_Start = Ticks();
+		Chain.WAIT_StartCpuTime = ThreadCpuTime();
+	}
+	static void EndWait(ChainState& Chain)
+	{
+		LONGLONG now = Ticks();
+
+		Chain.WAIT_Last = now - Chain.WAIT_Start;
+		Chain.WAIT_Ticks += Chain.WAIT_Last;
+		Chain.WAIT_CpuTime += ThreadCpuTime() - Chain.WAIT_StartCpuTime;
+		Chain.WAIT_Frames++;
+
+		if (!Chain.WAIT_WindowStart)
+		{
+			Chain.WAIT_WindowStart = now;
+		}
+		else if (now - Chain.WAIT_WindowStart >= TIME_Frequency)
+		{
+			double waitMs = (double)Chain.WAIT_Ticks * 1000.0 / (double)TIME_Frequency;
+			Chain.WaitMsPerFrame = waitMs / (double)Chain.WAIT_Frames;
+			Chain.WaitCpuPercent = waitMs > 0.0 ? ((double)Chain.WAIT_CpuTime / 10000.0) * 100.0 / waitMs : 0.0;
+			Chain.LatencyMs = Chain.LAT_Frames ? (double)Chain.LAT_Ticks * 1000.0 / (double)TIME_Frequency / (double)Chain.LAT_Frames : 0.0;
+
+			Chain.WAIT_WindowStart = now;
+			Chain.WAIT_Ticks = 0;
+			Chain.WAIT_CpuTime = 0;
+			Chain.WAIT_Frames = 0;
+			Chain.LAT_Ticks = 0;
+			Chain.LAT_Frames = 0;
+		}
+	}
+	// The overlay is drawn on, and the frame rate measured for, a single swap chain: the first one to present,
+	// or whichever presents next once it has not done so for a second
+	static bool IsOverlayChain(const void* pChainKey)
+	{
+		LONGLONG now = Ticks();
+		if (pChainKey != pOverlayChain && pOverlayChain && now - OverlayLastPresent < TIME_Frequency)
+			return false;
+
+		pOverlayChain = pChainKey;
+		OverlayLastPresent = now;
+		return true;
+	}
+	// Called once per Present of the overlay's swap chain, as the frame is handed to the runtime.
+	// pChain is the chain's limiter state, if the limiter keeps any for it.
+	static void SampleFrame(const ChainState* pChain)
+	{
+		LONGLONG now = Ticks();
+		if (OverlayLastSample)
+		{
+			double ms = (double)(now - OverlayLastSample) * 1000.0 / (double)TIME_Frequency;
+			Stats.AddFrameTime(ms);
+
+			double wait_ms = pChain && ActiveMode != FPS_NONE ? (double)pChain->WAIT_Last * 1000.0 / (double)TIME_Frequency : -1.0;
+			// GPU times come back a few frames late, the graph shows the newest one there is
+			double gpu_ms = Gpu.GetLastResult() == GpuTimer::Valid ? Gpu.GetLastMs() : -1.0;
+			Graph.AddSample((float)ms, (float)wait_ms, (float)gpu_ms);
+		}
+		OverlayLastSample = now;
+	}
+	// Called right before Present, after the application's last EndScene of the frame
+	static void ShowOverlay(IDirect3DDevice9* device, IDirect3DSurface9* pBackBuffer)
+	{
+		D3DSURFACE_DESC desc;
+		if (FAILED(pBackBuffer->GetDesc(&desc)))
+			return;
+
+		// The counter follows the last 50 frames, the lows the whole window
+		double frametime = Stats.GetRecentMeanMs(50);
+		uint32_t fps = frametime > 0.0 ? static_cast<uint32_t>(0.5 + 1000.0 / frametime) : 0;
 
 		static int space = 0;
-		if (!pFPSFont || !pTimeFont)
+		static int space_wait = 0;
+		static int space_line = 0;
+		bool bCounter = bDisplayFPSCounter;
+		if (bCounter && !Text.IsCreated())
 		{
 			D3DDEVICE_CREATION_PARAMETERS cparams;
 			RECT rect;
 			device->GetCreationParameters(&cparams);
 			GetClientRect(cparams.hFocusWindow, &rect);
 
-			D3DXFONT_DESC fps_font;
-			ZeroMemory(&fps_font, sizeof(D3DXFONT_DESC));
-			fps_font.Height = rect.bottom / 20;
-			fps_font.Width = 0;
-			fps_font.Weight = 400;
-			fps_font.MipLevels = 0;
-			fps_font.Italic = 0;
-			fps_font.CharSet = DEFAULT_CHARSET;
-			fps_font.OutputPrecision = OUT_DEFAULT_PRECIS;
-			fps_font.Quality = ANTIALIASED_QUALITY;
-			fps_font.PitchAndFamily = DEFAULT_PITCH | FF_DONTCARE;
-			wchar_t FaceName[] = L"Arial";
-			memcpy(&fps_font.FaceName, &FaceName, sizeof(FaceName));
-
-			D3DXFONT_DESC time_font = fps_font;
-			time_font.Height = rect.bottom / 35;
-			space = fps_font.Height + 5;
-
-			if (D3DXCreateFontIndirect(device, &fps_font, &pFPSFont) != D3D_OK)
-				return;
-
-			if (D3DXCreateFontIndirect(device, &time_font, &pTimeFont) != D3D_OK)
-				return;
+			int fps_height = rect.bottom / 20;
+			int time_height = rect.bottom / 35;
+			space = fps_height + 5;
+			space_wait = space + time_height + 5;
+			space_line = time_height + 5;
+
+			bCounter = Text.Create(fps_height, time_height);
 		}
-		else
+
+		// The application has ended its scenes for the frame and may have left anything bound, so the overlay gets
+		// a scene of its own on the back buffer, and the render target and viewport are put back afterwards
+		IDirect3DSurface9* pTarget = nullptr;
+		if (FAILED(device->GetRenderTarget(0, &pTarget)) || !pTarget)
+			return;
+
+		D3DVIEWPORT9 viewport;
+		device->GetViewport(&viewport);
+		if (pTarget != pBackBuffer)
+			device->SetRenderTarget(0, pBackBuffer);
+
+		if (SUCCEEDED(device->BeginScene()))
 		{
-			auto DrawTextOutline = [](ID3DXFont* pFont, FLOAT X, FLOAT Y, D3DXCOLOR dColor, CONST PCHAR cString, ...)
+			if (bCounter)
+			{
+				static const D3DCOLOR YELLOW = D3DCOLOR_XRGB(0xF7, 0xF7, 0);
+				Text.Print(OverlayText::Large, 10, 10, YELLOW, "%02d", fps);
+				Text.Print(OverlayText::Small, 10, space, YELLOW, "%.01f ms", frametime);
+
+				int y = space_wait;
+
+				FrameStats<>::Summary summary = Stats.GetSummary();
+				if (summary.P99Ms > 0.0 && summary.P999Ms > 0.0)
 				{
-					const D3DXCOLOR BLACK(D3DCOLOR_XRGB(0, 0, 0));
-					CHAR cBuffer[101] = "";
+					Text.Print(OverlayText::Small, 10, y, YELLOW, "1%% low %.0f, 0.1%% low %.0f", 1000.0 / summary.P99Ms, 1000.0 / summary.P999Ms);
+					y += space_line;
+				}
 
-					va_list oArgs;
-					va_start(oArgs, cString);
-					_vsnprintf((cBuffer + strlen(cBuffer)), (sizeof(cBuffer) - strlen(cBuffer)), cString, oArgs);
-					va_end(oArgs);
+				// A disjoint frame or a device without timestamps is shown as such, a time would be made up
+				GpuTimer::Result gpu = Gpu.GetLastResult();
+				if (gpu == GpuTimer::Valid)
+				{
+					Text.Print(OverlayText::Small, 10, y, YELLOW, "gpu %.01f ms", Gpu.GetStats().GetRecentMeanMs(50));
+					y += space_line;
+				}
+				else if (gpu == GpuTimer::Disjoint || gpu == GpuTimer::Unsupported)
+				{
+					Text.Print(OverlayText::Small, 10, y, YELLOW, gpu == GpuTimer::Disjoint ? "gpu disjoint" : "gpu n/a");
+					y += space_line;
+				}
 
-					RECT Rect[5] =
-					{
-						{ X - 1, Y, X + 500.0f, Y + 50.0f },
-						{ X, Y - 1, X + 500.0f, Y + 50.0f },
-						{ X + 1, Y, X + 500.0f, Y + 50.0f },
-						{ X, Y + 1, X + 500.0f, Y + 50.0f },
-						{ X, Y, X + 500.0f, Y + 50.0f },
-					};
-
-					if (dColor != BLACK)
-					{
-						for (auto i = 0; i < 4; i++)
-							pFont->DrawText(NULL, cBuffer, -1, &Rect[i], DT_NOCLIP, BLACK);
-					}
+				const ChainState* pChain = GetDisplayedChain();
+				if (ActiveMode != FPS_NONE && pChain)
+				{
+					Text.Print(OverlayText::Small, 10, y, YELLOW, "wait %.01f ms, %.0f%% cpu", pChain->WaitMsPerFrame, pChain->WaitCpuPercent);
+					y += space_line;
 
-					pFont->DrawText(NULL, cBuffer, -1, &Rect[4], DT_NOCLIP, dColor);
-				};
+					Text.Print(OverlayText::Small, 10, y, YELLOW, "latency %.01f ms", pChain->LatencyMs);
+					y += space_line;
+				}
+
+				if (Queue.GetDepth())
+				{
+					Text.Print(OverlayText::Small, 10, y, YELLOW, "queue %u, wait %.01f ms", Queue.GetDepth(), Queue.GetWaitMsPerFrame());
+					y += space_line;
+				}
+
+				if (Capture.IsRunning())
+					Text.Print(OverlayText::Small, 10, y, YELLOW, "capturing");
+
+				// Everything above goes out as one batch
+				Text.Draw(device);
+			}
+
+			if (bDisplayFrameTimeGraph)
+			{
+				// Along the bottom left corner, twice the limit's frame time high when there is a limit
+				float width = desc.Width / 4.0f;
+				float height = desc.Height / 6.0f;
+				float max_ms = fFPSLimit > 0.0 ? (float)(2000.0 / fFPSLimit) : 50.0f;
+				Graph.Draw(device, desc.Width, desc.Height, 10.0f, desc.Height - height - 10.0f, width, height, max_ms);
+			}
 
-			static char str_format_fps[] = "%02d";
-			static char str_format_time[] = "%.01f ms";
-			static const D3DXCOLOR YELLOW(D3DCOLOR_XRGB(0xF7, 0xF7, 0));
-			DrawTextOutline(pFPSFont, 10, 10, YELLOW, str_format_fps, fps);
-			DrawTextOutline(pTimeFont, 10, space, YELLOW, str_format_time, (1.0f / fps) * 1000.0f);
+			device->EndScene();
 		}
+
+		if (pTarget != pBackBuffer)
+		{
+			device->SetRenderTarget(0, pTarget);
+			device->SetViewport(&viewport);
+		}
+		pTarget->Release();
 	}
 
 private:
-	static void Ticks()
+	static ULONGLONG ThreadCpuTime()
+	{
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+			return 0;
+		return ((ULONGLONG)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) + ((ULONGLONG)user.dwHighDateTime << 32 | user.dwLowDateTime);
+	}
+	static LONGLONG Ticks()
 	{
 		LARGE_INTEGER counter;
 		QueryPerformanceCounter(&counter);
-		TIME_Ticks = (double)counter.QuadPart / TIME_Frequency;
+		return counter.QuadPart;
 	}
 };
 
 FrameLimiter::FPSLimitMode mFPSLimitMode = FrameLimiter::FPSLimitMode::FPS_NONE;
+LimiterControl RuntimeControl;
 
-HRESULT m_IDirect3DDevice9Ex::Present(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+void ApplyFPSLimit(double FPSLimit, int ModeSetting)
 {
-	if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_REALTIME)
-		while (!FrameLimiter::Sync_RT());
-	else if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
-		while (!FrameLimiter::Sync_SLP());
+	fFPSLimit = FPSLimit > 0.0 ? FPSLimit : 0.0;
+	nFPSLimitModeSetting = ModeSetting >= 1 && ModeSetting <= 4 ? ModeSetting : 1;
 
-	return ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+	// The limiter also runs for a background limit or Present skipping alone, chains are then only held back
+	// out of focus. Without any of them it still measures each swap chain's frames, for captures.
+	FrameLimiter::FPSLimitMode mode = FrameLimiter::FPSLimitMode::FPS_NONE;
+	if (fFPSLimit > 0.0 || FrameLimiter::fBackgroundFPSLimit > 0.0 || FrameLimiter::nBackgroundSkip != FrameLimiter::BackgroundSkip::SKIP_NONE)
+		mode = FrameLimiter::ModeFromSetting(nFPSLimitModeSetting);
+
+	FrameLimiter::Init(mode);
+	mFPSLimitMode = mode;
 }
 
-HRESULT m_IDirect3DDevice9Ex::PresentEx(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
+// Takes over what hotkeys or an external tool asked for through the control block. Only called from
+// Present, so the limiter is never switched in the middle of a frame.
+void ApplyRuntimeControl()
+{
+	LimiterControl::Settings Requested;
+	if (!RuntimeControl.Poll(Requested))
+		return;
+
+	if (Requested.FPSLimit != fFPSLimit || Requested.FPSLimitMode != nFPSLimitModeSetting)
+		ApplyFPSLimit(Requested.FPSLimit, Requested.FPSLimitMode);
+	bDisplayFPSCounter = Requested.DisplayFPSCounter != 0;
+
+	RuntimeControl.Publish({ fFPSLimit, nFPSLimitModeSetting, bDisplayFPSCounter });
+}
+
+// Called from the window procedure, changes are only requested here and applied on the next Present
+void OnHotkey(WPARAM Key)
 {
-	if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_REALTIME)
-		while (!FrameLimiter::Sync_RT());
-	else if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
-		while (!FrameLimiter::Sync_SLP());
+	if (!Key)
+		return;
+
+	if (Key == (WPARAM)nHotkeyFPSLimitUp || Key == (WPARAM)nHotkeyFPSLimitDown)
+	{
+		double step = Key == (WPARAM)nHotkeyFPSLimitUp ? fHotkeyFPSLimitStep : -fHotkeyFPSLimitStep;
+		RuntimeControl.Request([step](LimiterControl::Settings& Requested)
+			{
+				Requested.FPSLimit = Requested.FPSLimit + step > 0.0 ? Requested.FPSLimit + step : 0.0;
+			});
+	}
+	else if (Key == (WPARAM)nHotkeyFPSLimitMode)
+	{
+		RuntimeControl.Request([](LimiterControl::Settings& Requested)
+			{
+				Requested.FPSLimitMode = Requested.FPSLimitMode % 4 + 1;
+			});
+	}
+	else if (Key == (WPARAM)nHotkeyDisplayFPSCounter)
+	{
+		RuntimeControl.Request([](LimiterControl::Settings& Requested)
+			{
+				Requested.DisplayFPSCounter = !Requested.DisplayFPSCounter;
+			});
+	}
+}
+
+// The functions below hold everything done around the intercepted calls. They are shared by
+// the wrapper classes and the vtable hooks, so both interception modes behave the same.
+
+// pChainKey is the runtime object presenting: the swap chain, or the device for its implicit swap chain.
+// Returns false when the frame is not to be presented; the caller then skips the runtime's Present but
+// still calls OnPresentDone, so skipped frames are paced like presented ones.
+bool OnPresent(const void* pChainKey, RasterSource* pRaster, bool bOverlayChain)
+{
+	bool bPresent = !FrameLimiter::IsSkippingPresent();
+
+	if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_NONE && !bFrameCapture)
+	{
+		if (bOverlayChain)
+			FrameLimiter::SampleFrame(nullptr);
+		return bPresent;
+	}
+
+	FrameLimiter::ChainState* pChain = FrameLimiter::AcquireChain(pChainKey);
+	if (!pChain)
+	{
+		if (bOverlayChain)
+			FrameLimiter::SampleFrame(nullptr);
+		return bPresent;
+	}
+
+	if (!FrameLimiter::IsWaitingAfterPresent())
+		FrameLimiter::Wait(*pChain, pRaster);
+
+	if (bOverlayChain)
+		FrameLimiter::SampleFrame(pChain);
+	FrameLimiter::BeginPresent(*pChain);
 
-	return ProxyInterface->PresentEx(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
+	FrameLimiter::ReleaseChain(*pChain);
+	return bPresent;
 }
 
-HRESULT m_IDirect3DDevice9Ex::EndScene()
+// Present is the only call made exactly once per frame, engines often run several scenes per frame
+bool IsDrawingOverlay(const void* pChainKey, bool& bOverlayChain)
 {
-	if (bDisplayFPSCounter)
-		FrameLimiter::ShowFPS(ProxyInterface);
+	ApplyRuntimeControl();
+	FrameLimiter::Capture.Poll();
 
-	return ProxyInterface->EndScene();
+	bOverlayChain = FrameLimiter::IsOverlayChain(pChainKey);
+	return bOverlayChain && (bDisplayFPSCounter || bDisplayFrameTimeGraph) && !FrameLimiter::IsSkippingPresent();
+}
+
+// Device of a swap chain, without keeping a reference to it; the swap chain does that
+IDirect3DDevice9* GetSwapChainDevice(IDirect3DSwapChain9* pSwapChain)
+{
+	IDirect3DDevice9* pDevice = nullptr;
+	if (SUCCEEDED(pSwapChain->GetDevice(&pDevice)) && pDevice)
+		pDevice->Release();
+	return pDevice;
+}
+
+bool OnPresent(IDirect3DDevice9* pDevice)
+{
+	FrameLimiter::UpdateBackground(pDevice);
+
+	bool bOverlayChain;
+	IDirect3DSurface9* pBackBuffer = nullptr;
+	if (IsDrawingOverlay(pDevice, bOverlayChain) && SUCCEEDED(pDevice->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &pBackBuffer)) && pBackBuffer)
+	{
+		FrameLimiter::ShowOverlay(pDevice, pBackBuffer);
+		pBackBuffer->Release();
+	}
+
+	if (bOverlayChain)
+		FrameLimiter::Gpu.EndFrame(pDevice);
+
+	FrameLimiter::Queue.Wait(pDevice);
+
+	DeviceRasterSource Raster(pDevice);
+	return OnPresent(pDevice, &Raster, bOverlayChain);
+}
+
+bool OnPresent(IDirect3DSwapChain9* pSwapChain)
+{
+	bool bOverlayChain;
+	bool bOverlay = IsDrawingOverlay(pSwapChain, bOverlayChain);
+
+	IDirect3DDevice9* pDevice = bOverlay || FrameLimiter::Queue.GetDepth() || FrameLimiter::IsWatchingBackground() ? GetSwapChainDevice(pSwapChain) : nullptr;
+	FrameLimiter::UpdateBackground(pDevice);
+
+	IDirect3DSurface9* pBackBuffer = nullptr;
+	if (bOverlay && pDevice && SUCCEEDED(pSwapChain->GetBackBuffer(0, D3DBACKBUFFER_TYPE_MONO, &pBackBuffer)) && pBackBuffer)
+	{
+		FrameLimiter::ShowOverlay(pDevice, pBackBuffer);
+		pBackBuffer->Release();
+	}
+
+	if (bOverlayChain && pDevice)
+		FrameLimiter::Gpu.EndFrame(pDevice);
+
+	if (pDevice)
+		FrameLimiter::Queue.Wait(pDevice);
+
+	SwapChainRasterSource Raster(pSwapChain);
+	return OnPresent(pSwapChain, &Raster, bOverlayChain);
+}
+
+// GPU times are only measured while the overlay shows them, and only for the overlay's swap chain
+bool IsTimingGpu(const void* pChainKey)
+{
+	return pChainKey == FrameLimiter::pOverlayChain && (bDisplayFPSCounter || bDisplayFrameTimeGraph);
+}
+
+// Waiting once Present has returned holds the application back before it simulates the next frame
+// rather than after, so the frame is built from input read just before it is handed to the runtime
+void OnPresentDone(const void* pChainKey, IDirect3DDevice9* pDevice, HRESULT hr)
+{
+	FrameLimiter::OnPresentResult(hr);
+
+	if (pDevice)
+	{
+		FrameLimiter::Queue.Issue(pDevice);
+		if (IsTimingGpu(pChainKey))
+			FrameLimiter::Gpu.BeginFrame(pDevice);
+	}
+
+	if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_NONE && !bFrameCapture)
+		return;
+
+	FrameLimiter::ChainState* pChain = FrameLimiter::AcquireChain(pChainKey);
+	if (!pChain)
+		return;
+
+	if (FrameLimiter::IsWaitingAfterPresent())
+		FrameLimiter::Wait(*pChain, nullptr);
+
+	FrameLimiter::EndPresent(*pChain);
+	FrameLimiter::ReleaseChain(*pChain);
+}
+
+void OnPresentDone(IDirect3DDevice9* pDevice, HRESULT hr)
+{
+	OnPresentDone(pDevice, pDevice, hr);
+}
+
+void OnPresentDone(IDirect3DSwapChain9* pSwapChain, HRESULT hr)
+{
+	OnPresentDone(pSwapChain, FrameLimiter::Queue.GetDepth() || IsTimingGpu(pSwapChain) ? GetSwapChainDevice(pSwapChain) : nullptr, hr);
+}
+
+HRESULT m_IDirect3DDevice9Ex::Present(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+{
+	HRESULT hr = OnPresent(ProxyInterface) ? ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion) : D3D_OK;
+
+	OnPresentDone(ProxyInterface, hr);
+
+	return hr;
+}
+
+HRESULT m_IDirect3DDevice9Ex::PresentEx(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
+{
+	HRESULT hr = OnPresent(ProxyInterface) ? ProxyInterface->PresentEx(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags) : D3D_OK;
+
+	OnPresentDone(ProxyInterface, hr);
+
+	return hr;
 }
 
 void CaptureMouse(HWND hWnd)
@@ -414,32 +1074,97 @@ void ForceFullScreenRefreshRateInHz(D3DPRESENT_PARAMETERS* pPresentationParamete
 	}
 }
 
-HRESULT m_IDirect3D9Ex::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice9** ppReturnedDeviceInterface)
+void OnCreateDevice(HWND hFocusWindow, D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode = NULL)
 {
 	g_hFocusWindow = hFocusWindow ? hFocusWindow : pPresentationParameters->hDeviceWindow;
 	if (bForceWindowedMode)
 	{
-		ForceWindowed(pPresentationParameters);
+		ForceWindowed(pPresentationParameters, pFullscreenDisplayMode);
 	}
 
 	if (nFullScreenRefreshRateInHz)
 		ForceFullScreenRefreshRateInHz(pPresentationParameters);
 
-	if (bDisplayFPSCounter)
+	FrameLimiter::Queue.Release();
+	FrameLimiter::Gpu.Release();
+
+	// The overlay can be switched off at runtime, so its atlas is looked after whenever it exists.
+	// A new device may come with a new window size, the glyphs are rasterized again for it.
+	FrameLimiter::Text.Release();
+	FrameLimiter::Graph.OnLostDevice();
+}
+
+void OnReset(D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode = NULL)
+{
+	// Queries issued before a Reset may never signal, the rings start over with new ones
+	FrameLimiter::Queue.Release();
+	FrameLimiter::Gpu.Release();
+
+	if (bForceWindowedMode)
+		ForceWindowed(pPresentationParameters, pFullscreenDisplayMode);
+
+	if (nFullScreenRefreshRateInHz)
+		ForceFullScreenRefreshRateInHz(pPresentationParameters);
+
+	FrameLimiter::Text.OnLostDevice();
+	FrameLimiter::Graph.OnLostDevice();
+}
+
+void OnResetDone(HRESULT hr)
+{
+	// Nothing to restore here, the overlay creates its texture and state blocks again on its next draw
+	UNREFERENCED_PARAMETER(hr);
+}
+
+// Devices the application holds through a wrapper
+volatile LONG nWrappedDevices = 0;
+
+void OnDeviceCreated()
+{
+	InterlockedIncrement(&nWrappedDevices);
+}
+
+// The queries and overlay resources each hold a reference to the device, so they go with the application's last
+// one, or the runtime would never release the device. Writer threads are killed with the process, so a capture
+// still running is stopped here as well, to let its writer complete the files while the game shuts down; it goes
+// on in a new file once another device presents. Games that exit without releasing their device leave it to the
+// capture key.
+void OnDeviceReleased()
+{
+	FrameLimiter::Queue.Release();
+	FrameLimiter::Gpu.Release();
+	FrameLimiter::Text.Release();
+	FrameLimiter::Graph.OnLostDevice();
+
+	if (InterlockedDecrement(&nWrappedDevices) == 0)
+		FrameLimiter::Capture.Suspend();
+}
+
+ULONG m_IDirect3DDevice9Ex::Release()
+{
+	if (InterlockedDecrement(&AppRefCount) == 0)
+		OnDeviceReleased();
+
+	ULONG count = ProxyInterface->Release();
+
+	if (count == 0)
 	{
-		if (FrameLimiter::pFPSFont)
-			FrameLimiter::pFPSFont->Release();
-		if (FrameLimiter::pTimeFont)
-			FrameLimiter::pTimeFont->Release();
-		FrameLimiter::pFPSFont = nullptr;
-		FrameLimiter::pTimeFont = nullptr;
+		delete this;
 	}
 
+	return count;
+}
+
+HRESULT m_IDirect3D9Ex::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice9** ppReturnedDeviceInterface)
+{
+	OnCreateDevice(hFocusWindow, pPresentationParameters);
+
 	HRESULT hr = ProxyInterface->CreateDevice(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, ppReturnedDeviceInterface);
 
 	if (SUCCEEDED(hr) && ppReturnedDeviceInterface)
 	{
-		*ppReturnedDeviceInterface = new m_IDirect3DDevice9Ex((IDirect3DDevice9Ex*)*ppReturnedDeviceInterface, this, IID_IDirect3DDevice9);
+		*ppReturnedDeviceInterface = new m_IDirect3DDevice9Ex((IDirect3DDevice9Ex*)*ppReturnedDeviceInterface, this, IID_IDirect3DDevice9, bWrapResources);
+		OnDeviceCreated();
 	}
 
 	return hr;
@@ -447,97 +1172,191 @@ HRESULT m_IDirect3D9Ex::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND h
 
 HRESULT m_IDirect3DDevice9Ex::Reset(D3DPRESENT_PARAMETERS* pPresentationParameters)
 {
-	if (bForceWindowedMode)
-		ForceWindowed(pPresentationParameters);
+	OnReset(pPresentationParameters);
 
-	if (nFullScreenRefreshRateInHz)
-		ForceFullScreenRefreshRateInHz(pPresentationParameters);
+	auto hRet = ProxyInterface->Reset(pPresentationParameters);
 
-	if (bDisplayFPSCounter)
-	{
-		if (FrameLimiter::pFPSFont)
-			FrameLimiter::pFPSFont->OnLostDevice();
-		if (FrameLimiter::pTimeFont)
-			FrameLimiter::pTimeFont->OnLostDevice();
-	}
+	// The runtime recreates the back buffers, so the swap chains must not hand out the old wrappers
+	if (SUCCEEDED(hRet))
+		ProxyAddressLookupTable->ReleaseChildren<m_IDirect3DSwapChain9Ex>();
 
-	auto hRet = ProxyInterface->Reset(pPresentationParameters);
+	OnResetDone(hRet);
+
+	return hRet;
+}
 
-	if (bDisplayFPSCounter)
+HRESULT m_IDirect3D9Ex::CreateDeviceEx(THIS_ UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode, IDirect3DDevice9Ex** ppReturnedDeviceInterface)
+{
+	OnCreateDevice(hFocusWindow, pPresentationParameters, pFullscreenDisplayMode);
+
+	HRESULT hr = ProxyInterface->CreateDeviceEx(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, pFullscreenDisplayMode, ppReturnedDeviceInterface);
+
+	if (SUCCEEDED(hr) && ppReturnedDeviceInterface)
 	{
-		if (SUCCEEDED(hRet))
-		{
-			if (FrameLimiter::pFPSFont)
-				FrameLimiter::pFPSFont->OnResetDevice();
-			if (FrameLimiter::pTimeFont)
-				FrameLimiter::pTimeFont->OnResetDevice();
-		}
+		*ppReturnedDeviceInterface = new m_IDirect3DDevice9Ex(*ppReturnedDeviceInterface, this, IID_IDirect3DDevice9Ex, bWrapResources);
+		OnDeviceCreated();
 	}
 
+	return hr;
+}
+
+HRESULT m_IDirect3DDevice9Ex::ResetEx(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode)
+{
+	OnReset(pPresentationParameters, pFullscreenDisplayMode);
+
+	auto hRet = ProxyInterface->ResetEx(pPresentationParameters, pFullscreenDisplayMode);
+
+	// The runtime recreates the back buffers, so the swap chains must not hand out the old wrappers
+	if (SUCCEEDED(hRet))
+		ProxyAddressLookupTable->ReleaseChildren<m_IDirect3DSwapChain9Ex>();
+
+	OnResetDone(hRet);
+
 	return hRet;
 }
 
-HRESULT m_IDirect3D9Ex::CreateDeviceEx(THIS_ UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode, IDirect3DDevice9Ex** ppReturnedDeviceInterface)
+HRESULT m_IDirect3DSwapChain9Ex::Present(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
 {
-	g_hFocusWindow = hFocusWindow ? hFocusWindow : pPresentationParameters->hDeviceWindow;
-	if (bForceWindowedMode)
+	HRESULT hr = OnPresent(ProxyInterface) ? ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags) : D3D_OK;
+
+	OnPresentDone(ProxyInterface, hr);
+
+	return hr;
+}
+
+// Vtable slots patched when InterceptionMode = 1
+namespace VTableSlot
+{
+	constexpr UINT CreateDevice = 16;			// IDirect3D9
+	constexpr UINT CreateDeviceEx = 20;			// IDirect3D9Ex
+	constexpr UINT Reset = 16;					// IDirect3DDevice9
+	constexpr UINT Present = 17;
+	constexpr UINT PresentEx = 121;				// IDirect3DDevice9Ex
+	constexpr UINT ResetEx = 132;
+	constexpr UINT SwapChainPresent = 3;		// IDirect3DSwapChain9
+}
+
+typedef HRESULT(STDMETHODCALLTYPE* CreateDevice_fn)(IDirect3D9*, UINT, D3DDEVTYPE, HWND, DWORD, D3DPRESENT_PARAMETERS*, IDirect3DDevice9**);
+typedef HRESULT(STDMETHODCALLTYPE* CreateDeviceEx_fn)(IDirect3D9Ex*, UINT, D3DDEVTYPE, HWND, DWORD, D3DPRESENT_PARAMETERS*, D3DDISPLAYMODEEX*, IDirect3DDevice9Ex**);
+typedef HRESULT(STDMETHODCALLTYPE* Reset_fn)(IDirect3DDevice9*, D3DPRESENT_PARAMETERS*);
+typedef HRESULT(STDMETHODCALLTYPE* Present_fn)(IDirect3DDevice9*, CONST RECT*, CONST RECT*, HWND, CONST RGNDATA*);
+typedef HRESULT(STDMETHODCALLTYPE* PresentEx_fn)(IDirect3DDevice9Ex*, CONST RECT*, CONST RECT*, HWND, CONST RGNDATA*, DWORD);
+typedef HRESULT(STDMETHODCALLTYPE* ResetEx_fn)(IDirect3DDevice9Ex*, D3DPRESENT_PARAMETERS*, D3DDISPLAYMODEEX*);
+typedef HRESULT(STDMETHODCALLTYPE* SwapChainPresent_fn)(IDirect3DSwapChain9*, CONST RECT*, CONST RECT*, HWND, CONST RGNDATA*, DWORD);
+
+HRESULT STDMETHODCALLTYPE hk_Reset(IDirect3DDevice9* pDevice, D3DPRESENT_PARAMETERS* pPresentationParameters)
+{
+	OnReset(pPresentationParameters);
+
+	HRESULT hr = VTableHook::Original<Reset_fn>(pDevice, VTableSlot::Reset)(pDevice, pPresentationParameters);
+
+	OnResetDone(hr);
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE hk_Present(IDirect3DDevice9* pDevice, CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+{
+	HRESULT hr = OnPresent(pDevice) ? VTableHook::Original<Present_fn>(pDevice, VTableSlot::Present)(pDevice, pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion) : D3D_OK;
+
+	OnPresentDone(pDevice, hr);
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE hk_PresentEx(IDirect3DDevice9Ex* pDevice, CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
+{
+	HRESULT hr = OnPresent(pDevice) ? VTableHook::Original<PresentEx_fn>(pDevice, VTableSlot::PresentEx)(pDevice, pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags) : D3D_OK;
+
+	OnPresentDone(pDevice, hr);
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE hk_ResetEx(IDirect3DDevice9Ex* pDevice, D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode)
+{
+	OnReset(pPresentationParameters, pFullscreenDisplayMode);
+
+	HRESULT hr = VTableHook::Original<ResetEx_fn>(pDevice, VTableSlot::ResetEx)(pDevice, pPresentationParameters, pFullscreenDisplayMode);
+
+	OnResetDone(hr);
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE hk_SwapChainPresent(IDirect3DSwapChain9* pSwapChain, CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion, DWORD dwFlags)
+{
+	HRESULT hr = OnPresent(pSwapChain) ? VTableHook::Original<SwapChainPresent_fn>(pSwapChain, VTableSlot::SwapChainPresent)(pSwapChain, pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags) : D3D_OK;
+
+	OnPresentDone(pSwapChain, hr);
+
+	return hr;
+}
+
+void HookDevice(IDirect3DDevice9* pDevice)
+{
+	VTableHook::Patch(pDevice, VTableSlot::Reset, (void*)hk_Reset);
+	VTableHook::Patch(pDevice, VTableSlot::Present, (void*)hk_Present);
+
+	// Only patch the Ex slots when the object really implements them, a plain device's vtable ends before them
+	IDirect3DDevice9Ex* pDeviceEx = nullptr;
+	if (SUCCEEDED(pDevice->QueryInterface(IID_IDirect3DDevice9Ex, (void**)&pDeviceEx)) && pDeviceEx)
 	{
-		ForceWindowed(pPresentationParameters, pFullscreenDisplayMode);
+		VTableHook::Patch(pDeviceEx, VTableSlot::Reset, (void*)hk_Reset);
+		VTableHook::Patch(pDeviceEx, VTableSlot::Present, (void*)hk_Present);
+		VTableHook::Patch(pDeviceEx, VTableSlot::PresentEx, (void*)hk_PresentEx);
+		VTableHook::Patch(pDeviceEx, VTableSlot::ResetEx, (void*)hk_ResetEx);
+		pDeviceEx->Release();
 	}
 
-	if (nFullScreenRefreshRateInHz)
-		ForceFullScreenRefreshRateInHz(pPresentationParameters);
-
-	if (bDisplayFPSCounter)
+	// Additional swap chains are instances of the same runtime class, so the implicit one is enough to reach the vtable
+	IDirect3DSwapChain9* pSwapChain = nullptr;
+	if (SUCCEEDED(pDevice->GetSwapChain(0, &pSwapChain)) && pSwapChain)
 	{
-		if (FrameLimiter::pFPSFont)
-			FrameLimiter::pFPSFont->Release();
-		if (FrameLimiter::pTimeFont)
-			FrameLimiter::pTimeFont->Release();
-		FrameLimiter::pFPSFont = nullptr;
-		FrameLimiter::pTimeFont = nullptr;
+		VTableHook::Patch(pSwapChain, VTableSlot::SwapChainPresent, (void*)hk_SwapChainPresent);
+		pSwapChain->Release();
 	}
+}
 
-	HRESULT hr = ProxyInterface->CreateDeviceEx(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, pFullscreenDisplayMode, ppReturnedDeviceInterface);
+HRESULT STDMETHODCALLTYPE hk_CreateDevice(IDirect3D9* pD3D, UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice9** ppReturnedDeviceInterface)
+{
+	OnCreateDevice(hFocusWindow, pPresentationParameters);
 
-	if (SUCCEEDED(hr) && ppReturnedDeviceInterface)
+	HRESULT hr = VTableHook::Original<CreateDevice_fn>(pD3D, VTableSlot::CreateDevice)(pD3D, Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, ppReturnedDeviceInterface);
+
+	if (SUCCEEDED(hr) && ppReturnedDeviceInterface && *ppReturnedDeviceInterface)
 	{
-		*ppReturnedDeviceInterface = new m_IDirect3DDevice9Ex(*ppReturnedDeviceInterface, this, IID_IDirect3DDevice9Ex);
+		HookDevice(*ppReturnedDeviceInterface);
 	}
 
 	return hr;
 }
 
-HRESULT m_IDirect3DDevice9Ex::ResetEx(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode)
+HRESULT STDMETHODCALLTYPE hk_CreateDeviceEx(IDirect3D9Ex* pD3D, UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, D3DDISPLAYMODEEX* pFullscreenDisplayMode, IDirect3DDevice9Ex** ppReturnedDeviceInterface)
 {
-	if (bForceWindowedMode)
-		ForceWindowed(pPresentationParameters, pFullscreenDisplayMode);
+	OnCreateDevice(hFocusWindow, pPresentationParameters, pFullscreenDisplayMode);
 
-	if (nFullScreenRefreshRateInHz)
-		ForceFullScreenRefreshRateInHz(pPresentationParameters);
+	HRESULT hr = VTableHook::Original<CreateDeviceEx_fn>(pD3D, VTableSlot::CreateDeviceEx)(pD3D, Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, pFullscreenDisplayMode, ppReturnedDeviceInterface);
 
-	if (bDisplayFPSCounter)
+	if (SUCCEEDED(hr) && ppReturnedDeviceInterface && *ppReturnedDeviceInterface)
 	{
-		if (FrameLimiter::pFPSFont)
-			FrameLimiter::pFPSFont->OnLostDevice();
-		if (FrameLimiter::pTimeFont)
-			FrameLimiter::pTimeFont->OnLostDevice();
+		HookDevice(*ppReturnedDeviceInterface);
 	}
 
-	auto hRet = ProxyInterface->ResetEx(pPresentationParameters, pFullscreenDisplayMode);
+	return hr;
+}
+
+void HookDirect3D(IDirect3D9* pD3D)
+{
+	VTableHook::Patch(pD3D, VTableSlot::CreateDevice, (void*)hk_CreateDevice);
 
-	if (bDisplayFPSCounter)
+	IDirect3D9Ex* pD3DEx = nullptr;
+	if (SUCCEEDED(pD3D->QueryInterface(IID_IDirect3D9Ex, (void**)&pD3DEx)) && pD3DEx)
 	{
-		if (SUCCEEDED(hRet))
-		{
-			if (FrameLimiter::pFPSFont)
-				FrameLimiter::pFPSFont->OnResetDevice();
-			if (FrameLimiter::pTimeFont)
-				FrameLimiter::pTimeFont->OnResetDevice();
-		}
+		VTableHook::Patch(pD3DEx, VTableSlot::CreateDevice, (void*)hk_CreateDevice);
+		VTableHook::Patch(pD3DEx, VTableSlot::CreateDeviceEx, (void*)hk_CreateDeviceEx);
+		pD3DEx->Release();
 	}
-
-	return hRet;
 }
 
 LRESULT WINAPI CustomWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, int idx)
@@ -571,12 +1390,14 @@ LRESULT WINAPI CustomWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
 				CaptureMouse(hWnd);
 			break;
 		case WM_ACTIVATEAPP:
+			FrameLimiter::RequestBackgroundCheck();
 			if (bDoNotNotifyOnTaskSwitch && wParam == FALSE)
 				return 0;
 			if (bCaptureMouse && wParam == TRUE)
 				CaptureMouse(hWnd);
 			break;
 		case WM_KILLFOCUS:
+			FrameLimiter::RequestBackgroundCheck();
 			if (bDoNotNotifyOnTaskSwitch)
 			{
 				if ((HWND)wParam == NULL)
@@ -587,7 +1408,16 @@ LRESULT WINAPI CustomWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
 					return 0;
 			}
 			break;
+		case WM_KEYDOWN:
+		case WM_SYSKEYDOWN:
+			if ((lParam & (1 << 30)) == 0) // not an auto-repeat
+				OnHotkey(wParam);
+			break;
 		case WM_SETFOCUS:
+			FrameLimiter::RequestBackgroundCheck();
+			if (bCaptureMouse)
+				CaptureMouse(hWnd);
+			break;
 		case WM_MOUSEACTIVATE:
 			if (bCaptureMouse)
 				CaptureMouse(hWnd);
@@ -1000,9 +1830,12 @@ bool WINAPI DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
 			GetModuleFileNameA(hm, path, sizeof(path));
 			strcpy(strrchr(path, '\\'), "\\d3d9.ini");
 			bForceWindowedMode = GetPrivateProfileInt("MAIN", "ForceWindowedMode", 0, path) != 0;
-			fFPSLimit = static_cast<float>(GetPrivateProfileInt("MAIN", "FPSLimit", 0, path));
+			char FPSLimit[32];
+			GetPrivateProfileString("MAIN", "FPSLimit", "0", FPSLimit, sizeof(FPSLimit), path);
+			fFPSLimit = atof(FPSLimit); // fractional rates such as 59.94 are allowed
 			nFullScreenRefreshRateInHz = GetPrivateProfileInt("MAIN", "FullScreenRefreshRateInHz", 0, path);
 			bDisplayFPSCounter = GetPrivateProfileInt("MAIN", "DisplayFPSCounter", 0, path);
+			bDisplayFrameTimeGraph = GetPrivateProfileInt("MAIN", "DisplayFrameTimeGraph", 0, path);
 			bEnableHooks = GetPrivateProfileInt("MAIN", "EnableHooks", 0, path);
 			bUsePrimaryMonitor = GetPrivateProfileInt("FORCEWINDOWED", "UsePrimaryMonitor", 0, path) != 0;
 			bCenterWindow = GetPrivateProfileInt("FORCEWINDOWED", "CenterWindow", 1, path) != 0;
@@ -1011,19 +1844,64 @@ bool WINAPI DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
 			nForceWindowStyle = GetPrivateProfileInt("FORCEWINDOWED", "ForceWindowStyle", 0, path);
 			bCaptureMouse = GetPrivateProfileInt("FORCEWINDOWED", "CaptureMouse", 0, path) != 0;
 
-			if (fFPSLimit > 0.0f)
+			// None of the options above looks at individual resources, so unless asked to, textures, surfaces
+			// and buffers are handed out as the runtime's own interfaces and only the device and swap chains are wrapped
+			bWrapResources = GetPrivateProfileInt("MAIN", "WrapResources", 0, path) != 0;
+			nInterceptionMode = GetPrivateProfileInt("MAIN", "InterceptionMode", 0, path);
+			FrameLimiter::nLimitedChain = GetPrivateProfileInt("MAIN", "FPSLimitSwapChain", -1, path);
+			bFPSLimitAfterPresent = GetPrivateProfileInt("MAIN", "FPSLimitWaitPoint", 0, path) == 1;
+			FrameLimiter::Queue.SetDepth(GetPrivateProfileInt("MAIN", "MaxFramesInFlight", 0, path));
+
+			char BackgroundFPSLimit[32];
+			GetPrivateProfileString("MAIN", "BackgroundFPSLimit", "0", BackgroundFPSLimit, sizeof(BackgroundFPSLimit), path);
+			FrameLimiter::fBackgroundFPSLimit = atof(BackgroundFPSLimit);
+			switch (GetPrivateProfileInt("MAIN", "BackgroundRenderSkip", 0, path))
 			{
-				FrameLimiter::FPSLimitMode mode = (GetPrivateProfileInt("MAIN", "FPSLimitMode", 1, path) == 2) ? FrameLimiter::FPSLimitMode::FPS_ACCURATE : FrameLimiter::FPSLimitMode::FPS_REALTIME;
-				if (mode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
-					timeBeginPeriod(1);
+			case 1:
+				FrameLimiter::nBackgroundSkip = FrameLimiter::BackgroundSkip::SKIP_HIDDEN;
+				break;
+			case 2:
+				FrameLimiter::nBackgroundSkip = FrameLimiter::BackgroundSkip::SKIP_BACKGROUND;
+				break;
+			default:
+				FrameLimiter::nBackgroundSkip = FrameLimiter::BackgroundSkip::SKIP_NONE;
+				break;
+			}
 
-				FrameLimiter::Init(mode);
-				mFPSLimitMode = mode;
+			char RasterBand[32];
+			GetPrivateProfileString("MAIN", "RasterBandTop", "0.0", RasterBand, sizeof(RasterBand), path);
+			FrameLimiter::fRasterBandTop = atof(RasterBand);
+			GetPrivateProfileString("MAIN", "RasterBandBottom", "0.05", RasterBand, sizeof(RasterBand), path);
+			FrameLimiter::fRasterBandBottom = atof(RasterBand);
+
+			ApplyFPSLimit(fFPSLimit, GetPrivateProfileInt("MAIN", "FPSLimitMode", 1, path));
+
+			// Limiter settings may be changed while the game runs, by hotkeys or through a shared memory block
+			nHotkeyFPSLimitUp = GetPrivateProfileInt("HOTKEYS", "FPSLimitUp", 0, path);
+			nHotkeyFPSLimitDown = GetPrivateProfileInt("HOTKEYS", "FPSLimitDown", 0, path);
+			nHotkeyFPSLimitMode = GetPrivateProfileInt("HOTKEYS", "FPSLimitMode", 0, path);
+			nHotkeyDisplayFPSCounter = GetPrivateProfileInt("HOTKEYS", "DisplayFPSCounter", 0, path);
+			char FPSLimitStep[32];
+			GetPrivateProfileString("HOTKEYS", "FPSLimitStep", "5", FPSLimitStep, sizeof(FPSLimitStep), path);
+			fHotkeyFPSLimitStep = atof(FPSLimitStep);
+			bool bHotkeys = nHotkeyFPSLimitUp || nHotkeyFPSLimitDown || nHotkeyFPSLimitMode || nHotkeyDisplayFPSCounter;
+
+			RuntimeControl.Open(GetPrivateProfileInt("MAIN", "RuntimeControl", 0, path) != 0, { fFPSLimit, nFPSLimitModeSetting, bDisplayFPSCounter });
+
+			// Captures are written next to the ini, and may be started with the game or by a key
+			int nFrameCaptureKey = GetPrivateProfileInt("MAIN", "FrameCaptureKey", 0, path);
+			bFrameCapture = nFrameCaptureKey || GetPrivateProfileInt("MAIN", "FrameCapture", 0, path);
+			if (bFrameCapture)
+			{
+				char CaptureDir[MAX_PATH];
+				strcpy_s(CaptureDir, path);
+				*(strrchr(CaptureDir, '\\') + 1) = '\0';
+				FrameLimiter::Capture.Configure(CaptureDir, GetPrivateProfileInt("MAIN", "FrameCaptureCSV", 1, path) != 0, nFrameCaptureKey);
+				if (GetPrivateProfileInt("MAIN", "FrameCapture", 0, path))
+					FrameLimiter::Capture.Start();
 			}
-			else
-				mFPSLimitMode = FrameLimiter::FPSLimitMode::FPS_NONE;
 
-			if (bEnableHooks && (bDoNotNotifyOnTaskSwitch || bCaptureMouse))
+			if (bEnableHooks && (bDoNotNotifyOnTaskSwitch || bCaptureMouse || bHotkeys))
 			{
 				GetSystemWindowsDirectoryA(WinDir, MAX_PATH);
 
@@ -1112,7 +1990,7 @@ bool WINAPI DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
 	break;
 	case DLL_PROCESS_DETACH:
 	{
-		if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
+		if (FrameLimiter::bTimerPeriodSet)
 			timeEndPeriod(1);
 
 		if (d3d9dll)
@@ -1264,6 +2142,12 @@ IDirect3D9* WINAPI Direct3DCreate9(UINT SDKVersion)
 
 	if (pD3D9)
 	{
+		if (nInterceptionMode == 1)
+		{
+			HookDirect3D(pD3D9);
+			return pD3D9;
+		}
+
 		return new m_IDirect3D9Ex((IDirect3D9Ex*)pD3D9, IID_IDirect3D9);
 	}
 
@@ -1281,6 +2165,12 @@ HRESULT WINAPI Direct3DCreate9Ex(UINT SDKVersion, IDirect3D9Ex** ppD3D)
 
 	if (SUCCEEDED(hr) && ppD3D)
 	{
+		if (nInterceptionMode == 1)
+		{
+			HookDirect3D(*ppD3D);
+			return hr;
+		}
+
 		*ppD3D = new m_IDirect3D9Ex(*ppD3D, IID_IDirect3D9Ex);
 	}
 
@@ -0,0 +1,76 @@
+#ifndef __VTABLEHOOK_H
+#define __VTABLEHOOK_H
+
+#include <windows.h>
+
+// Redirects single slots of a COM object's vtable. Only the patched methods take a detour, every
+// other call goes straight into the runtime. Objects of different classes (e.g. a HAL and a REF
+// device, or a device and a device Ex) may use different vtables, so the original function of each
+// patched slot is remembered per vtable and looked up again from the object on every call.
+class VTableHook
+{
+public:
+    // Returns the original function of the slot, or nullptr if it could not be patched
+    static void* Patch(void* pInterface, UINT Slot, void* pHook)
+    {
+        if (!pInterface || !pHook)
+            return nullptr;
+
+        void** VTable = *reinterpret_cast<void***>(pInterface);
+
+        AcquireSRWLockExclusive(&Lock);
+
+        // Another object sharing this vtable has already been patched
+        void* pOriginal = Find(VTable, Slot);
+        if (!pOriginal && VTable[Slot] != pHook && Count < MaxEntries)
+        {
+            pOriginal = VTable[Slot];
+
+            // Publish the original before the hook can be reached through the slot
+            Entries[Count] = { VTable, Slot, pOriginal };
+            InterlockedIncrement(&Count);
+
+            DWORD dwProtect[2];
+            VirtualProtect(&VTable[Slot], sizeof(void*), PAGE_EXECUTE_READWRITE, &dwProtect[0]);
+            InterlockedExchangePointer(&VTable[Slot], pHook);
+            VirtualProtect(&VTable[Slot], sizeof(void*), dwProtect[0], &dwProtect[1]);
+        }
+
+        ReleaseSRWLockExclusive(&Lock);
+
+        return pOriginal;
+    }
+
+    // Called from inside the hooks, so it does not take the lock; entries are never removed or changed once published
+    template <typename F>
+    static F Original(void* pInterface, UINT Slot)
+    {
+        return reinterpret_cast<F>(Find(*reinterpret_cast<void***>(pInterface), Slot));
+    }
+
+private:
+    struct Entry
+    {
+        void** VTable;
+        UINT Slot;
+        void* Original;
+    };
+
+    static void* Find(void** VTable, UINT Slot)
+    {
+        for (LONG i = 0; i < Count; i++)
+        {
+            if (Entries[i].VTable == VTable && Entries[i].Slot == Slot)
+                return Entries[i].Original;
+        }
+        return nullptr;
+    }
+
+    static constexpr LONG MaxEntries = 64;
+
+    static inline Entry Entries[MaxEntries] = {};
+    static inline volatile LONG Count = 0;
+    static inline SRWLOCK Lock = SRWLOCK_INIT;
+};
+
+#endif // __VTABLEHOOK_H
@@ -0,0 +1,99 @@
+#include "Test.h"
+#include "FramePacer.h"
+
+// The pacer is driven by a simulated performance counter, in the units QueryPerformanceFrequency usually reports
+static constexpr LONGLONG Frequency = 10000000;
+
+// Runs Frames frames of an application that spends a random part of each period on its own work, then waits
+// like Sync_SLP: until the deadline, waking up to MaxOversleepMs late. Returns the time the last frame was released.
+static LONGLONG RunFrames(FramePacer& Pacer, double Period, LONGLONG Start, ULONGLONG Frames, double MaxOversleepMs, TestRandom& Random)
+{
+	LONGLONG Now = Start;
+	for (ULONGLONG i = 0; i < Frames; i++)
+	{
+		Now += (LONGLONG)(Period * (0.2 + 0.7 * Random.Next()));
+		if (Now < Pacer.GetDeadline())
+			Now = Pacer.GetDeadline() + (LONGLONG)(MaxOversleepMs * Random.Next() * (double)Frequency / 1000.0);
+		Pacer.Advance(Now);
+	}
+	return Now;
+}
+
+TEST(FramePacer_DeadlinesStayOnTheGrid)
+{
+	// Frame n is due at exactly Start + round(n * Period), fractional periods included
+	const double Rates[] = { 60.0, 59.94, 143.856 };
+	for (double Rate : Rates)
+	{
+		FramePacer Pacer;
+		const LONGLONG Start = 123456789;
+		Pacer.Start(Rate, Frequency, Start);
+
+		double Period = (double)Frequency / Rate;
+		bool bOnGrid = true;
+		for (ULONGLONG n = 1; n <= 1000000 && bOnGrid; n++)
+		{
+			bOnGrid = Pacer.GetDeadline() == Start + (LONGLONG)llround((double)n * Period);
+			Pacer.Advance(Pacer.GetDeadline());
+		}
+		CHECK(bOnGrid);
+		CHECK(Pacer.GetResyncs() == 0);
+	}
+}
+
+TEST(FramePacer_NoLongTermDrift)
+{
+	// Every wake-up is late by up to a millisecond, yet the error after a million frames is no larger than after a
+	// thousand: lateness never carries over, so the achieved rate converges on the target
+	const double Rates[] = { 60.0, 59.94, 143.856 };
+	for (double Rate : Rates)
+	{
+		TestRandom Random(12345);
+		FramePacer Pacer;
+		const LONGLONG Start = 0;
+		Pacer.Start(Rate, Frequency, Start);
+		double Period = (double)Frequency / Rate;
+		LONGLONG Tolerance = Frequency / 1000 + 1;
+
+		LONGLONG Released = RunFrames(Pacer, Period, Start, 1000, 1.0, Random);
+		CHECK(llabs(Released - (Start + llround(1000.0 * Period))) <= Tolerance);
+
+		Released = RunFrames(Pacer, Period, Released, 1000000 - 1000, 1.0, Random);
+		CHECK(llabs(Released - (Start + llround(1000000.0 * Period))) <= Tolerance);
+
+		double Achieved = 1000000.0 * (double)Frequency / (double)(Released - Start);
+		CHECK_NEAR(Achieved, Rate, Rate * 1e-6);
+		CHECK(Pacer.GetResyncs() == 0);
+	}
+}
+
+TEST(FramePacer_CatchesUpWithinAFrame)
+{
+	// A frame released most of a period late leaves the schedule alone, the next one is due sooner instead
+	FramePacer Pacer;
+	Pacer.Start(60.0, Frequency, 0);
+	double Period = (double)Frequency / 60.0;
+
+	Pacer.Advance(Pacer.GetDeadline() + (LONGLONG)(0.9 * Period));
+	CHECK(Pacer.GetResyncs() == 0);
+	CHECK(Pacer.GetDeadline() == llround(2.0 * Period));
+}
+
+TEST(FramePacer_ResyncsAfterAStall)
+{
+	// After a stall of several frames the schedule starts over from the release, rather than presenting the
+	// missed frames back to back
+	FramePacer Pacer;
+	Pacer.Start(59.94, Frequency, 0);
+	double Period = (double)Frequency / 59.94;
+
+	LONGLONG Now = Pacer.GetDeadline() + (LONGLONG)(5.0 * Period);
+	Pacer.Advance(Now);
+	CHECK(Pacer.GetResyncs() == 1);
+	CHECK(Pacer.GetDeadline() == Now + llround(Period));
+
+	// And it keeps to the new grid from there on
+	Pacer.Advance(Pacer.GetDeadline());
+	CHECK(Pacer.GetDeadline() == Now + llround(2.0 * Period));
+	CHECK(Pacer.GetResyncs() == 1);
+}
@@ -0,0 +1,169 @@
+#include "Test.h"
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Percentiles come from 0.1ms histogram buckets, reported at the bucket's center
+static constexpr double HalfBucketMs = 0.05 + 1e-9;
+
+// Statistics of the last Window frames of Times, computed the slow way
+struct BruteForceSummary
+{
+	double MinMs, MaxMs, MeanMs, StdDevMs, P99Ms, P999Ms;
+
+	BruteForceSummary(const std::vector<double>& Times, size_t Window)
+	{
+		std::vector<double> Last(Times.end() - std::min(Window, Times.size()), Times.end());
+		MinMs = *std::min_element(Last.begin(), Last.end());
+		MaxMs = *std::max_element(Last.begin(), Last.end());
+
+		double Sum = 0.0;
+		for (double Ms : Last)
+			Sum += Ms;
+		MeanMs = Sum / (double)Last.size();
+		double Squares = 0.0;
+		for (double Ms : Last)
+			Squares += (Ms - MeanMs) * (Ms - MeanMs);
+		StdDevMs = sqrt(Squares / (double)Last.size());
+
+		// The slowest Fraction of the frames, at least one, reaches the percentile
+		std::sort(Last.begin(), Last.end(), std::greater<double>());
+		P99Ms = Last[std::max<size_t>(1, (size_t)ceil(0.01 * (double)Last.size())) - 1];
+		P999Ms = Last[std::max<size_t>(1, (size_t)ceil(0.001 * (double)Last.size())) - 1];
+	}
+};
+
+TEST(FrameStats_Empty)
+{
+	FrameStats<> Stats;
+	FrameStats<>::Summary s = Stats.GetSummary();
+	CHECK(s.Frames == 0);
+	CHECK(s.MeanMs == 0.0);
+	CHECK(Stats.GetRecentMeanMs(50) == 0.0);
+}
+
+TEST(FrameStats_ConstantFrameTimes)
+{
+	FrameStats<> Stats;
+	for (int i = 0; i < 5000; i++)
+		Stats.AddFrameTime(16.0);
+
+	FrameStats<>::Summary s = Stats.GetSummary();
+	CHECK(s.Frames == 1024);
+	CHECK_NEAR(s.MinMs, 16.0, 1e-9);
+	CHECK_NEAR(s.MaxMs, 16.0, 1e-9);
+	CHECK_NEAR(s.MeanMs, 16.0, 1e-9);
+	CHECK_NEAR(s.StdDevMs, 0.0, 1e-6);
+	CHECK_NEAR(s.P99Ms, 16.0, 1e-9);
+	CHECK_NEAR(s.P999Ms, 16.0, 1e-9);
+}
+
+TEST(FrameStats_OldFramesLeaveTheWindow)
+{
+	// A slow stretch followed by a full window of fast frames no longer shows in any of the numbers
+	FrameStats<64> Stats;
+	for (int i = 0; i < 64; i++)
+		Stats.AddFrameTime(40.0);
+	for (int i = 0; i < 64; i++)
+		Stats.AddFrameTime(10.0);
+
+	FrameStats<64>::Summary s = Stats.GetSummary();
+	CHECK(s.Frames == 64);
+	CHECK_NEAR(s.MaxMs, 10.0, 1e-9);
+	CHECK_NEAR(s.MeanMs, 10.0, 1e-9);
+	CHECK_NEAR(s.P99Ms, 10.0, 1e-9);
+
+	// One hitch is enough to show up again
+	Stats.AddFrameTime(33.0);
+	s = Stats.GetSummary();
+	CHECK_NEAR(s.MaxMs, 33.0, 1e-9);
+	CHECK_NEAR(s.P99Ms, 33.0, HalfBucketMs);
+	CHECK_NEAR(s.MinMs, 10.0, 1e-9);
+}
+
+TEST(FrameStats_PercentileLows)
+{
+	// 1% of the window at 50ms: the 99th percentile frame time is one of them, the median frame is not
+	FrameStats<1000> Stats;
+	for (int i = 0; i < 1000; i++)
+		Stats.AddFrameTime(i % 100 == 0 ? 50.0 : 10.0);
+
+	FrameStats<1000>::Summary s = Stats.GetSummary();
+	CHECK_NEAR(s.P99Ms, 50.0, HalfBucketMs);
+	CHECK_NEAR(s.P999Ms, 50.0, HalfBucketMs);
+	CHECK_NEAR(s.MeanMs, 10.4, 1e-9);
+
+	// One frame less at 50ms and the 1% low falls back to the regular frames
+	FrameStats<1000> Fewer;
+	for (int i = 0; i < 1000; i++)
+		Fewer.AddFrameTime(i % 100 == 0 && i ? 50.0 : 10.0);
+	CHECK_NEAR(Fewer.GetSummary().P99Ms, 10.0, HalfBucketMs);
+	CHECK_NEAR(Fewer.GetSummary().P999Ms, 50.0, HalfBucketMs);
+}
+
+TEST(FrameStats_MatchesBruteForce)
+{
+	// Jittery frame times with occasional spikes, checked against a full recomputation all along the way,
+	// across several window wraps and running sum rebuilds. Percentiles are exact to half a 0.1ms bucket.
+	TestRandom Random(2024);
+	FrameStats<256> Stats;
+	std::vector<double> Times;
+
+	bool bMatches = true;
+	for (int i = 0; i < 5000 && bMatches; i++)
+	{
+		double Ms = 8.0 + 10.0 * Random.Next();
+		if (Random.Next() < 0.02)
+			Ms += 30.0 + 100.0 * Random.Next();
+		Stats.AddFrameTime(Ms);
+		Times.push_back(Ms);
+
+		if (i % 7)
+			continue;
+
+		BruteForceSummary Expected(Times, 256);
+		FrameStats<256>::Summary s = Stats.GetSummary();
+		bMatches = s.Frames == std::min<size_t>(Times.size(), 256) &&
+			fabs(s.MinMs - Expected.MinMs) < 1e-9 &&
+			fabs(s.MaxMs - Expected.MaxMs) < 1e-9 &&
+			fabs(s.MeanMs - Expected.MeanMs) < 1e-6 &&
+			fabs(s.StdDevMs - Expected.StdDevMs) < 1e-4 &&
+			fabs(s.P99Ms - Expected.P99Ms) <= HalfBucketMs &&
+			fabs(s.P999Ms - Expected.P999Ms) <= HalfBucketMs;
+		if (!bMatches)
+			printf("  frame %d differs\n", i);
+	}
+	CHECK(bMatches);
+}
+
+TEST(FrameStats_RecentMean)
+{
+	FrameStats<> Stats;
+	for (int i = 0; i < 100; i++)
+		Stats.AddFrameTime(20.0);
+	for (int i = 0; i < 10; i++)
+		Stats.AddFrameTime(10.0);
+
+	CHECK_NEAR(Stats.GetRecentMeanMs(10), 10.0, 1e-9);
+	CHECK_NEAR(Stats.GetRecentMeanMs(20), 15.0, 1e-9);
+	CHECK_NEAR(Stats.GetRecentMeanMs(5000), (100.0 * 20.0 + 10.0 * 10.0) / 110.0, 1e-9);
+}
+
+TEST(FrameStats_TimestampsPast32Bits)
+{
+	// Counters well beyond 32 bits, as a 10MHz performance counter reaches within minutes
+	FrameStats<> Stats;
+	const LONGLONG Frequency = 10000000;
+	LONGLONG Now = 0x7FFFFFFFLL * 1000;
+	for (int i = 0; i < 100; i++)
+	{
+		Stats.AddTimestamp(Now, Frequency);
+		Now += Frequency / 100;
+	}
+
+	FrameStats<>::Summary s = Stats.GetSummary();
+	CHECK(s.Frames == 99);
+	CHECK_NEAR(s.MeanMs, 10.0, 1e-9);
+}
@@ -0,0 +1,150 @@
+// Compares the cost of one call through each interception mode: a wrapper class forwarding to the runtime's object
+// (InterceptionMode = 0) against the runtime's object with patched vtable slots (InterceptionMode = 1). The runtime is
+// stood in for by a COM object with empty methods, so the numbers are the interception overhead alone and the
+// benchmark runs without a GPU. A method neither mode acts on is measured as well as one both intercept.
+
+#include <windows.h>
+#include <stdio.h>
+#include "vtablehook.h"
+
+struct IBenchTarget : IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE Untouched(UINT Value) = 0;
+	virtual HRESULT STDMETHODCALLTYPE Intercepted(UINT Value) = 0;
+};
+
+constexpr UINT InterceptedSlot = 4;		// After the three IUnknown methods and Untouched
+
+typedef HRESULT(STDMETHODCALLTYPE* Intercepted_fn)(IBenchTarget*, UINT);
+
+static volatile UINT Sink = 0;
+
+// Each Tag is its own class with its own vtable, so patching one leaves the others as the runtime made them
+template <UINT Tag>
+class BenchTarget : public IBenchTarget
+{
+public:
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** ppvObj) override { *ppvObj = nullptr; return E_NOINTERFACE; }
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	__declspec(noinline) HRESULT STDMETHODCALLTYPE Untouched(UINT Value) override { Sink = Value + Tag; return S_OK; }
+	__declspec(noinline) HRESULT STDMETHODCALLTYPE Intercepted(UINT Value) override { Sink = Value - Tag; return S_OK; }
+};
+
+// Stands in for the work the wrapper does around an intercepted call, the same in both modes
+__declspec(noinline) static void OnIntercepted()
+{
+	Sink = Sink + 1;
+}
+
+// Forwards every method like the m_IDirect3D* classes do
+class m_BenchTarget : public IBenchTarget
+{
+public:
+	explicit m_BenchTarget(IBenchTarget* pTarget) : ProxyInterface(pTarget) { }
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObj) override { return ProxyInterface->QueryInterface(riid, ppvObj); }
+	ULONG STDMETHODCALLTYPE AddRef() override { return ProxyInterface->AddRef(); }
+	ULONG STDMETHODCALLTYPE Release() override { return ProxyInterface->Release(); }
+
+	HRESULT STDMETHODCALLTYPE Untouched(UINT Value) override
+	{
+		return ProxyInterface->Untouched(Value);
+	}
+
+	HRESULT STDMETHODCALLTYPE Intercepted(UINT Value) override
+	{
+		OnIntercepted();
+
+		return ProxyInterface->Intercepted(Value);
+	}
+
+private:
+	IBenchTarget* ProxyInterface;
+};
+
+HRESULT STDMETHODCALLTYPE hk_Intercepted(IBenchTarget* pTarget, UINT Value)
+{
+	OnIntercepted();
+
+	return VTableHook::Original<Intercepted_fn>(pTarget, InterceptedSlot)(pTarget, Value);
+}
+
+// Keeps the compiler from seeing which object a call goes to, as it cannot for the game's calls into the runtime
+__declspec(noinline) static IBenchTarget* Opaque(IBenchTarget* pTarget)
+{
+	static IBenchTarget* volatile Slot;
+	Slot = pTarget;
+	return Slot;
+}
+
+static constexpr UINT Iterations = 20000000;
+static constexpr UINT Runs = 5;
+
+// Best of Runs, in nanoseconds per call
+template <typename F>
+static double Measure(IBenchTarget* pTarget, F Call)
+{
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	double Best = 0.0;
+	for (UINT Run = 0; Run < Runs; Run++)
+	{
+		LARGE_INTEGER Start, End;
+		QueryPerformanceCounter(&Start);
+		for (UINT i = 0; i < Iterations; i++)
+			Call(pTarget, i);
+		QueryPerformanceCounter(&End);
+
+		double Ns = (double)(End.QuadPart - Start.QuadPart) * 1e9 / (double)Frequency.QuadPart / (double)Iterations;
+		if (!Run || Ns < Best)
+			Best = Ns;
+	}
+	return Best;
+}
+
+template <UINT Tag>
+static void PatchFiller()
+{
+	static BenchTarget<Tag> Filler;
+	VTableHook::Patch(&Filler, InterceptedSlot, (void*)hk_Intercepted);
+}
+
+int main()
+{
+	static BenchTarget<0> Native;
+	static BenchTarget<1> Patched;
+	static BenchTarget<2> Wrapped;
+	static m_BenchTarget Wrapper(&Wrapped);
+
+	// The wrapper patches seven slots across the Direct3D objects, the hooks look theirs up among as many entries
+	PatchFiller<10>(); PatchFiller<11>(); PatchFiller<12>();
+	PatchFiller<13>(); PatchFiller<14>(); PatchFiller<15>();
+	if (!VTableHook::Patch(&Patched, InterceptedSlot, (void*)hk_Intercepted))
+	{
+		printf("patching the vtable failed\n");
+		return 1;
+	}
+
+	IBenchTarget* pNative = Opaque(&Native);
+	IBenchTarget* pPatched = Opaque(&Patched);
+	IBenchTarget* pWrapper = Opaque(&Wrapper);
+
+	auto Untouched = [](IBenchTarget* p, UINT i) { p->Untouched(i); };
+	auto Intercepted = [](IBenchTarget* p, UINT i) { p->Intercepted(i); };
+
+	double NativeUntouched = Measure(pNative, Untouched);
+	double PatchedUntouched = Measure(pPatched, Untouched);
+	double WrapperUntouched = Measure(pWrapper, Untouched);
+	double NativeIntercepted = Measure(pNative, Intercepted);
+	double PatchedIntercepted = Measure(pPatched, Intercepted);
+	double WrapperIntercepted = Measure(pWrapper, Intercepted);
+
+	printf("ns per call, best of %u runs of %u calls\n", Runs, Iterations);
+	printf("%-22s %10s %14s %14s\n", "", "runtime", "vtable patch", "wrapper");
+	printf("%-22s %10.2f %14.2f %14.2f\n", "method not intercepted", NativeUntouched, PatchedUntouched, WrapperUntouched);
+	printf("%-22s %10.2f %14.2f %14.2f\n", "intercepted method", NativeIntercepted, PatchedIntercepted, WrapperIntercepted);
+	return 0;
+}
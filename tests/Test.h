@@ -0,0 +1,86 @@
+#pragma once
+
+#include <windows.h>
+#include <math.h>
+#include <stdio.h>
+
+// Self-registering test cases for the header-only parts of the wrapper that run without Direct3D.
+// Every TEST runs once from main; a failing CHECK reports its expression and marks the test as
+// failed without stopping it, so one run shows every broken expectation.
+class TestCase
+{
+public:
+	TestCase(const char* Name, void (*Run)()) : Name(Name), Run(Run), Next(First)
+	{
+		First = this;
+	}
+
+	// Runs the tests in the order they were defined, returns the number that failed
+	static int RunAll()
+	{
+		// Registration prepends, so the list is reversed first
+		TestCase* Ordered = nullptr;
+		while (First)
+		{
+			TestCase* Test = First;
+			First = Test->Next;
+			Test->Next = Ordered;
+			Ordered = Test;
+		}
+
+		int Failed = 0, Total = 0;
+		for (TestCase* Test = Ordered; Test; Test = Test->Next)
+		{
+			bCurrentFailed = false;
+			Test->Run();
+			printf("%s %s\n", bCurrentFailed ? "FAIL" : "ok  ", Test->Name);
+			Failed += bCurrentFailed;
+			Total++;
+		}
+
+		printf("%d of %d tests failed\n", Failed, Total);
+		return Failed;
+	}
+
+	static void Fail(const char* File, int Line, const char* Expression)
+	{
+		printf("%s(%d): check failed: %s\n", File, Line, Expression);
+		bCurrentFailed = true;
+	}
+
+private:
+	const char* Name;
+	void (*Run)();
+	TestCase* Next;
+
+	static inline TestCase* First = nullptr;
+	static inline bool bCurrentFailed = false;
+};
+
+#define TEST(Name) \
+	static void Name(); \
+	static TestCase Name##_Case(#Name, Name); \
+	static void Name()
+
+#define CHECK(Expression) \
+	do { if (!(Expression)) TestCase::Fail(__FILE__, __LINE__, #Expression); } while (0)
+
+#define CHECK_NEAR(Actual, Expected, Tolerance) \
+	do { if (!(fabs((double)(Actual) - (double)(Expected)) <= (double)(Tolerance))) TestCase::Fail(__FILE__, __LINE__, #Actual " near " #Expected); } while (0)
+
+// Deterministic pseudo-random numbers, so a failing run can be repeated exactly
+class TestRandom
+{
+public:
+	explicit TestRandom(unsigned int Seed) : State(Seed) { }
+
+	// Uniform in [0, 1)
+	double Next()
+	{
+		State = State * 1664525u + 1013904223u;
+		return (double)(State >> 8) / (double)(1u << 24);
+	}
+
+private:
+	unsigned int State;
+};
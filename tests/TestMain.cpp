@@ -0,0 +1,6 @@
+#include "Test.h"
+
+int main()
+{
+	return TestCase::RunAll() ? 1 : 0;
+}